@@ -0,0 +1,93 @@
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+/* header rounded up so that the data of a block is aligned */
+#define ARENA_HEADER \
+    ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static _Thread_local Arena *current = NULL;
+
+Arena *arena_new(size_t block_size) {
+    Arena *arena = (Arena *)malloc(sizeof(Arena));
+    arena->blocks = NULL;
+    arena->cursor = NULL;
+    arena->end = NULL;
+    arena->block_size =
+        block_size == 0 ? ARENA_DEFAULT_BLOCK_SIZE : block_size;
+    arena->n_blocks = 0;
+    arena->allocated = 0;
+    return arena;
+}
+
+static char *arena_grow(Arena *arena, size_t size) {
+    size_t block_size = size > arena->block_size ? size : arena->block_size;
+    ArenaBlock *block = (ArenaBlock *)malloc(ARENA_HEADER + block_size);
+    block->size = block_size;
+    char *data = (char *)block + ARENA_HEADER;
+    arena->n_blocks++;
+    if (block_size > arena->block_size && arena->blocks != NULL) {
+        // keep bumping in the current block, the large one is full already
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+        return data;
+    }
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->cursor = data + size;
+    arena->end = data + block_size;
+    return data;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena->allocated += size;
+    if ((size_t)(arena->end - arena->cursor) < size) {
+        return arena_grow(arena, size);
+    }
+    char *p = arena->cursor;
+    arena->cursor += size;
+    return p;
+}
+
+void destroy_arena(Arena *arena) {
+    ArenaBlock *block = arena->blocks;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    if (current == arena) {
+        current = NULL;
+    }
+    free(arena);
+}
+
+void arena_enter(Arena *arena) { current = arena; }
+
+void arena_exit() { current = NULL; }
+
+Arena *unit_arena() { return current; }
+
+void *unit_malloc(size_t size) {
+    return current != NULL ? arena_alloc(current, size) : malloc(size);
+}
+
+void *unit_calloc(size_t n, size_t size) {
+    if (current == NULL) {
+        return calloc(n, size);
+    }
+    void *p = arena_alloc(current, n * size);
+    memset(p, 0, n * size);
+    return p;
+}
+
+void unit_free(void *p) {
+    if (current == NULL) {
+        free(p);
+    }
+}
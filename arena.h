@@ -0,0 +1,67 @@
+#ifndef MINI_COMPILER_ARENA_H
+#define MINI_COMPILER_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64u << 10)
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size; /* usable bytes after the header */
+} ArenaBlock;
+
+/**
+ * Bump allocator for the objects of one compilation unit. Memory is carved
+ * out of large blocks and is never given back one object at a time, the
+ * whole arena is released at once by `destroy_arena`.
+ */
+typedef struct Arena {
+    ArenaBlock *blocks; /* the most recent block first */
+    char *cursor;       /* next free byte of the current block */
+    char *end;          /* end of the current block */
+    size_t block_size;
+    size_t n_blocks;  /* number of malloc calls made by the arena */
+    size_t allocated; /* bytes handed out */
+} Arena;
+
+/**
+ * Create an empty arena, no block is allocated yet
+ * @param block_size size of the blocks, 0 for ARENA_DEFAULT_BLOCK_SIZE
+ * @return the arena
+ */
+Arena *arena_new(size_t block_size);
+
+/**
+ * Allocate from an arena, aligned for any type. Requests larger than the
+ * block size get a block of their own.
+ * @param arena
+ * @param size
+ * @return pointer to `size` uninitialized bytes, valid until the arena is
+ * destroyed
+ */
+void *arena_alloc(Arena *arena, size_t size);
+void destroy_arena(Arena *arena);
+
+/**
+ * Route the allocations of the compilation unit on this thread (tokens,
+ * spans, lexemes, parser items and symbols, parse tree nodes and their
+ * deques) to an arena until `arena_exit`. In between, the destroy functions
+ * of these objects are no-ops, so every such object must be created and
+ * dropped while the arena is entered.
+ * @param arena
+ */
+void arena_enter(Arena *arena);
+void arena_exit();
+
+/**
+ * The arena entered on this thread
+ * @return the arena, NULL if allocations go to the heap
+ */
+Arena *unit_arena();
+
+/* malloc/calloc/free of the compilation unit, see `arena_enter` */
+void *unit_malloc(size_t size);
+void *unit_calloc(size_t n, size_t size);
+void unit_free(void *p);
+
+#endif  // MINI_COMPILER_ARENA_H
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../arena.h"
+#include "../parser.h"
+#include "../source.h"
+
+#define ROUNDS 1000
+
+/*
+ * Parse the given sources on the heap and under an arena, counting the
+ * calls to the allocator. The binary is linked with
+ * -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so that every call made by
+ * the compiler goes through the counters below.
+ */
+
+static size_t n_malloc = 0;
+static size_t n_calloc = 0;
+static size_t n_realloc = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    n_malloc++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    n_calloc++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    n_realloc++;
+    return __real_realloc(p, size);
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Lex and parse a source the way func does, then tear everything down
+ * @return number of tokens of the source
+ */
+static size_t compile(const Source *src, Grammar *g) {
+    Lexer *lexer = lexer_new_n(src->data, src->len);
+    TokenTy ty;
+    do {
+        Token *token = lexer_next_token(lexer);
+        ty = token->ty;
+        destroy_token(token);
+    } while (ty != Eof);
+    destroy_lexer(lexer);
+
+    lexer = lexer_new_n(src->data, src->len);
+    TokenBuffer *tokens = lexer_tokenize_all(lexer);
+    size_t n_tokens = tokens->size;
+    destroy_lexer(lexer);
+    SLRParser *parser = slr_parser_init(g, &SLR_TABLE);
+    slr_parser_parse_buffer(parser, tokens, NULL);
+    ParseTree *tree = slr_parser_parse_tree(parser);
+    destroy_parse_tree(tree);
+    destroy_slr_parser(parser);
+    destroy_token_buffer(tokens);
+    return n_tokens;
+}
+
+static void run(const char *name, Source **srcs, size_t n_srcs, Grammar *g,
+                bool use_arena) {
+    n_malloc = n_calloc = n_realloc = 0;
+    size_t n_blocks = 0;
+    size_t n_tokens = 0;
+    double begin = now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < n_srcs; i++) {
+            Arena *arena = NULL;
+            if (use_arena) {
+                arena = arena_new(0);
+                arena_enter(arena);
+            }
+            n_tokens += compile(srcs[i], g);
+            if (use_arena) {
+                arena_exit();
+                n_blocks += arena->n_blocks;
+                destroy_arena(arena);
+            }
+        }
+    }
+    double elapsed = now() - begin;
+    size_t n_compiles = (size_t)ROUNDS * n_srcs;
+    printf("%-6s: %8.2f us/compile %8.1f malloc %6.1f calloc %6.1f realloc",
+           name, elapsed / (double)n_compiles * 1e6,
+           (double)n_malloc / (double)n_compiles,
+           (double)n_calloc / (double)n_compiles,
+           (double)n_realloc / (double)n_compiles);
+    printf(" %6.2f allocs/token",
+           (double)(n_malloc + n_calloc + n_realloc) / (double)n_tokens);
+    if (use_arena) {
+        printf(" (%.1f arena blocks)",
+               (double)n_blocks / (double)n_compiles);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    size_t n_srcs = (size_t)argc - 1;
+    Source **srcs = (Source **)malloc(sizeof(Source *) * (n_srcs + 1));
+    for (size_t i = 0; i < n_srcs; i++) {
+        srcs[i] = source_open(argv[i + 1]);
+        if (srcs[i] == NULL) {
+            printf("Fail to open %s\n", argv[i + 1]);
+            return 1;
+        }
+    }
+    Grammar *g = grammar_new();
+    printf("%zu sources, per compile:\n", n_srcs);
+    run("heap", srcs, n_srcs, g, false);
+    run("arena", srcs, n_srcs, g, true);
+    destroy_grammar(g);
+    for (size_t i = 0; i < n_srcs; i++) {
+        destroy_source(srcs[i]);
+    }
+    free(srcs);
+    return 0;
+}
@@ -0,0 +1,380 @@
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../interner.h"
+#include "../parser.h"
+#include "../program_gen.h"
+#include "../symbol_table.h"
+
+/*
+ * Throughput of the front end, one benchmark per stage, over synthetic
+ * programs from 1 KB to `--max-size` bytes (1 GB by default). The results
+ * are written to stdout as JSON, one benchmark per line, and a summary goes
+ * to stderr. With `--baseline FILE` (a previous output) each result is
+ * compared to the baseline one and the exit status is 1 if any of them got
+ * slower per token by more than `--threshold` percent (10 by default).
+ *
+ * The binary is linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+ * so that allocations can be counted, and the peak RSS of each benchmark is
+ * read from /proc after resetting it.
+ */
+
+#define MIN_SECONDS 0.2 /* rounds are repeated until they take that long */
+#define MAX_ROUNDS 5
+#define MAX_RESULTS 64
+
+static size_t n_allocs = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    n_allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    n_allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    n_allocs++;
+    return __real_realloc(p, size);
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Reset the peak RSS of the process to the current one, see proc(5) */
+static void reset_peak_rss() {
+    // give the memory freed by the previous benchmark back first
+    malloc_trim(0);
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    if (fp != NULL) {
+        fputs("5", fp);
+        fclose(fp);
+    }
+}
+
+/* Peak RSS in KB since the last reset, 0 if unknown */
+static size_t peak_rss_kb() {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp == NULL) {
+        return 0;
+    }
+    char line[256];
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "VmHWM: %zu kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+/* A valid program of about `size` bytes, the same on every run */
+static char *synthetic_program(size_t size, size_t *len) {
+    ProgramGenConf conf;
+    program_gen_conf_init(&conf, 42);
+    conf.size = size;
+    conf.n_identifiers = 1u << 16;
+    return program_gen(&conf, len);
+}
+
+typedef struct Input {
+    const char *src;
+    size_t size; /* requested size, results are keyed by it */
+    size_t len;
+    size_t tokens; /* tokens of the source, comments included */
+} Input;
+
+/* One benchmark, returns the number of operations it did, 0 if it failed */
+typedef size_t (*BenchFn)(const Input *input);
+
+static size_t bench_dfa(const Input *input) {
+    DFACursor cursor = dfa_cursor(&LEXER_DFA);
+    size_t restarts = 0;
+    for (const char *p = input->src; p < input->src + input->len; p++) {
+        dfa_next(&cursor, *p);
+        if (cursor.state == 0) {
+            restarts++;
+            dfa_reset(&cursor);
+            dfa_next(&cursor, *p);
+        }
+    }
+    return restarts;
+}
+
+static size_t bench_lexer_view(const Input *input) {
+    Lexer *lexer = lexer_new_n(input->src, input->len);
+    size_t n = 0;
+    TokenTy ty;
+    do {
+        ty = lexer_next_view(lexer).ty;
+        n++;
+    } while (ty != Eof);
+    destroy_lexer(lexer);
+    return n;
+}
+
+static size_t bench_lexer_token(const Input *input) {
+    Lexer *lexer = lexer_new_n(input->src, input->len);
+    size_t n = 0;
+    TokenTy ty;
+    do {
+        Token *token = lexer_next_token(lexer);
+        ty = token->ty;
+        destroy_token(token);
+        n++;
+    } while (ty != Eof);
+    destroy_lexer(lexer);
+    return n;
+}
+
+static Grammar *grammar = NULL;
+
+static size_t bench_parser_step(const Input *input) {
+    Lexer *lexer = lexer_new_n(input->src, input->len);
+    lexer_skip_comments(lexer, true);
+    SLRParser *parser = slr_parser_init(grammar, &SLR_TABLE);
+    size_t n = 0;
+    ParserState state;
+    do {
+        state = slr_parser_step(parser, lexer_next_view(lexer));
+        n++;
+    } while (state == PARSER_IDLE);
+    destroy_slr_parser(parser);
+    destroy_lexer(lexer);
+    return state == PARSER_ACCEPT ? n : 0;
+}
+
+/* A node per token, grouped four by four the way reductions do */
+static size_t bench_parse_tree(const Input *input) {
+    Lexer *lexer = lexer_new_n(input->src, input->len);
+    ParseTree *tree =
+        parse_tree_init(parse_tree_node_init(NULL, NODE_NON_TERMINAL));
+    ParseTreeNode *group = NULL;
+    size_t n = 0;
+    TokenView tok;
+    do {
+        tok = lexer_next_view(lexer);
+        if (n % 4 == 0) {
+            group = parse_tree_node_init(slr_symbol_init_nt('E'),
+                                         NODE_NON_TERMINAL);
+            parse_tree_node_add_last(tree->root, group);
+        }
+        SLRSymbol *sym = (SLRSymbol *)malloc(sizeof(SLRSymbol));
+        sym->token = tok;
+        parse_tree_node_add_last(group,
+                                 parse_tree_node_init(sym, NODE_TERMINAL));
+        n++;
+    } while (tok.ty != Eof);
+    destroy_parse_tree(tree);
+    destroy_lexer(lexer);
+    return n;
+}
+
+/* Declare every identifier, then look each of them up */
+static size_t bench_symbol_table(const Input *input) {
+    Lexer *lexer = lexer_new_n(input->src, input->len);
+    Interner *names = interner_new();
+    lexer->interner = names;
+    TokenBuffer *tokens = lexer_tokenize_all(lexer);
+    SymbolTable *table = symbol_table_new(names);
+    size_t n = 0;
+    for (size_t i = 0; i < tokens->size; i++) {
+        if (tokens->ty[i] == Identifier) {
+            symbol_table_insert(table, tokens->symbol[i], NatTy);
+            n++;
+        }
+    }
+    for (size_t i = 0; i < tokens->size; i++) {
+        if (tokens->ty[i] == Identifier) {
+            symbol_table_find(table, tokens->symbol[i]);
+            n++;
+        }
+    }
+    symbol_table_destroy(table);
+    destroy_token_buffer(tokens);
+    destroy_lexer(lexer);
+    destroy_interner(names);
+    return n;
+}
+
+typedef struct Bench {
+    const char *name;
+    BenchFn run;
+    size_t max_size; /* larger inputs are skipped */
+} Bench;
+
+static const Bench BENCHES[] = {
+    {"dfa", bench_dfa, SIZE_MAX},
+    {"lexer_view", bench_lexer_view, SIZE_MAX},
+    {"lexer_token", bench_lexer_token, 32u << 20},
+    // the parse tree keeps a node per token, about 100 bytes each
+    {"parser_step", bench_parser_step, 1u << 20},
+    {"parse_tree", bench_parse_tree, 32u << 20},
+    {"symbol_table", bench_symbol_table, 32u << 20},
+};
+
+typedef struct Result {
+    char name[64];
+    size_t size;
+    double ns_per_token;
+} Result;
+
+/* Size with an optional K, M or G suffix */
+static size_t parse_size(const char *s) {
+    char *end;
+    size_t size = strtoull(s, &end, 10);
+    switch (*end) {
+        case 'K':
+            return size << 10;
+        case 'M':
+            return size << 20;
+        case 'G':
+            return size << 30;
+        default:
+            return size;
+    }
+}
+
+/* Results of a previous run, see `run_bench` for the format */
+static size_t read_baseline(const char *path, Result *results, size_t max) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Fail to open %s\n", path);
+        exit(2);
+    }
+    char line[1024];
+    size_t n = 0;
+    while (n < max && fgets(line, sizeof(line), fp) != NULL) {
+        Result *r = &results[n];
+        const char *ns = strstr(line, "\"ns_per_token\": ");
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"size\": %zu", r->name,
+                   &r->size) == 2 &&
+            ns != NULL) {
+            r->ns_per_token = strtod(ns + strlen("\"ns_per_token\": "), NULL);
+            n++;
+        }
+    }
+    fclose(fp);
+    return n;
+}
+
+static Result run_bench(const Bench *bench, const Input *input, bool first) {
+    reset_peak_rss();
+    n_allocs = 0;
+    size_t ops = bench->run(input);
+    if (ops == 0) {
+        fprintf(stderr, "%s failed on %zu bytes\n", bench->name, input->len);
+        exit(1);
+    }
+    size_t allocs = n_allocs;
+    size_t rss = peak_rss_kb();
+    double best = 1e300, total = 0;
+    int rounds = 0;
+    while (rounds < MAX_ROUNDS && (rounds == 0 || total < MIN_SECONDS)) {
+        double begin = now();
+        bench->run(input);
+        double elapsed = now() - begin;
+        total += elapsed;
+        best = elapsed < best ? elapsed : best;
+        rounds++;
+    }
+    Result result = {.size = input->size};
+    snprintf(result.name, sizeof(result.name), "%s", bench->name);
+    // the tokens of the input, whatever the operations of the benchmark are
+    result.ns_per_token = best * 1e9 / (double)input->tokens;
+    printf(
+        "%s    {\"name\": \"%s\", \"size\": %zu, \"bytes\": %zu, "
+        "\"tokens\": %zu, \"ops\": %zu, \"rounds\": %d, \"seconds\": %.6f, "
+        "\"ns_per_token\": %.3f, \"tokens_per_s\": %.0f, \"mb_per_s\": %.2f, "
+        "\"allocs\": %zu, \"allocs_per_token\": %.3f, \"peak_rss_kb\": %zu}",
+        first ? "" : ",\n", bench->name, input->size, input->len,
+        input->tokens, ops,
+        rounds, best, result.ns_per_token, (double)input->tokens / best,
+        (double)input->len / best / 1e6, allocs,
+        (double)allocs / (double)input->tokens, rss);
+    fflush(stdout);
+    fprintf(stderr,
+            "%-12s %10zu B %10.2f ns/token %9.2f MB/s %12zu allocs %9zu KB\n",
+            bench->name, input->size, result.ns_per_token,
+            (double)input->len / best / 1e6, allocs, rss);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_size = 1u << 30;
+    const char *baseline_path = NULL;
+    double threshold = 10;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--max-size") == 0) {
+            max_size = parse_size(argv[i + 1]);
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baseline_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--threshold") == 0) {
+            threshold = strtod(argv[i + 1], NULL);
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--max-size N[K|M|G]] [--baseline FILE] "
+                    "[--threshold PERCENT]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    grammar = grammar_new();
+    static Result results[MAX_RESULTS];
+    size_t n_results = 0;
+    printf("{\"benchmarks\": [\n");
+    for (size_t size = 1u << 10; size <= max_size; size <<= 5) {
+        Input input = {.size = size};
+        char *src = synthetic_program(size, &input.len);
+        input.src = src;
+        input.tokens = bench_lexer_view(&input);
+        for (size_t b = 0; b < sizeof(BENCHES) / sizeof(BENCHES[0]); b++) {
+            if (size <= BENCHES[b].max_size && n_results < MAX_RESULTS) {
+                results[n_results] =
+                    run_bench(&BENCHES[b], &input, n_results == 0);
+                n_results++;
+            }
+        }
+        free(src);
+    }
+    printf("\n]}\n");
+    destroy_grammar(grammar);
+
+    if (baseline_path == NULL) {
+        return 0;
+    }
+    static Result baseline[MAX_RESULTS];
+    size_t n_baseline = read_baseline(baseline_path, baseline, MAX_RESULTS);
+    int ret = 0;
+    fprintf(stderr, "\nagainst %s:\n", baseline_path);
+    for (size_t i = 0; i < n_results; i++) {
+        for (size_t j = 0; j < n_baseline; j++) {
+            if (strcmp(results[i].name, baseline[j].name) != 0 ||
+                results[i].size != baseline[j].size) {
+                continue;
+            }
+            double change =
+                (results[i].ns_per_token / baseline[j].ns_per_token - 1) * 100;
+            bool regressed = change > threshold;
+            fprintf(stderr, "%-12s %10zu B %+8.1f%%%s\n", results[i].name,
+                    results[i].size, change, regressed ? "  REGRESSION" : "");
+            ret |= regressed;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lexer.h"
+#include "lexer_direct.h"
+
+#define SOURCE_SIZE (32u << 20)
+#define ROUNDS 5
+
+/*
+ * Every variant walks the whole source through the lexer DFA, restarting
+ * from the start state whenever a byte leads to the dead state. The number
+ * of restarts must be the same for all of them.
+ */
+
+static const char *SNIPPETS[] = {
+    "fun suc nat x -> T ? x + 1 : 0;\n",
+    "fun accumulate nat counter nat limit bool flag ->\n"
+    "    counter < limit & flag = T ? (accumulate counter+1 limit F) : 0;\n",
+    "[ a comment that is long enough to span a couple of simd blocks ]\n",
+    "\t\t    (identifierWithAFairlyLongName 1234567 987654321 F)\n",
+    "T ? (suc 0) + 2 : 0 + 1;\n\n\n",
+};
+
+static char *synthetic_source(size_t size) {
+    char *src = (char *)malloc(size + 1);
+    size_t n_snippets = sizeof(SNIPPETS) / sizeof(SNIPPETS[0]);
+    size_t len = 0;
+    unsigned seed = 42;
+    while (1) {
+        seed = seed * 1103515245 + 12345;
+        const char *snippet = SNIPPETS[(seed >> 16) % n_snippets];
+        size_t snippet_len = strlen(snippet);
+        if (len + snippet_len > size) {
+            break;
+        }
+        memcpy(src + len, snippet, snippet_len);
+        len += snippet_len;
+    }
+    src[len] = '\0';
+    return src;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* `dfa_next` of lexer.c, not inlined */
+static size_t walk_dfa_next(const char *p, const char *end) {
+    DFACursor cursor = dfa_cursor(&LEXER_DFA);
+    size_t restarts = 0;
+    for (; p < end; p++) {
+        dfa_next(&cursor, *p);
+        if (cursor.state == 0) {
+            restarts++;
+            dfa_reset(&cursor);
+            dfa_next(&cursor, *p);
+        }
+    }
+    return restarts;
+}
+
+/* two table lookups per byte, inlined */
+static size_t walk_table(const char *p, const char *end) {
+    const uint8_t *classes = LEXER_DFA.classes;
+    const uint8_t(*table)[DFA_N_STATES] = LEXER_DFA.table;
+    unsigned state = LEXER_DFA.start;
+    size_t restarts = 0;
+    for (; p < end; p++) {
+        unsigned class = classes[(uint8_t)*p];
+        state = table[class][state];
+        if (state == 0) {
+            restarts++;
+            state = table[class][LEXER_DFA.start];
+        }
+    }
+    return restarts;
+}
+
+/* generated switch per byte */
+static size_t walk_switch(const char *p, const char *end) {
+    unsigned state = LEXER_DFA.start;
+    size_t restarts = 0;
+    for (; p < end; p++) {
+        state = lexer_direct_next(state, (uint8_t)*p);
+        if (state == 0) {
+            restarts++;
+            state = lexer_direct_next(LEXER_DFA.start, (uint8_t)*p);
+        }
+    }
+    return restarts;
+}
+
+/* generated labels, the state lives in the program counter */
+static size_t walk_labels(const char *p, const char *end) {
+    unsigned state = LEXER_DFA.start;
+    size_t restarts = 0;
+    while (true) {
+        p = lexer_direct_run(p, end, &state);
+        if (p == end) {
+            return restarts;
+        }
+        restarts++;
+        state = LEXER_DFA.start;
+    }
+}
+
+int main() {
+    char *src = synthetic_source(SOURCE_SIZE);
+    size_t len = strlen(src);
+    struct {
+        const char *name;
+        size_t (*walk)(const char *p, const char *end);
+    } variants[] = {
+        {"dfa_next", walk_dfa_next},
+        {"table", walk_table},
+        {"switch", walk_switch},
+        {"labels", walk_labels},
+    };
+    double baseline = 0;
+    size_t expected = 0;
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        double best = 1e9;
+        size_t restarts = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            double begin = now();
+            restarts = variants[i].walk(src, src + len);
+            double elapsed = now() - begin;
+            best = elapsed < best ? elapsed : best;
+        }
+        if (i == 0) {
+            baseline = best;
+            expected = restarts;
+        } else if (restarts != expected) {
+            printf("%-8s: disagrees with dfa_next\n", variants[i].name);
+            return 1;
+        }
+        printf("%-8s: %8.1f MB/s %6.2fx\n", variants[i].name,
+               (double)len / best / 1e6, baseline / best);
+    }
+    free(src);
+    return 0;
+}
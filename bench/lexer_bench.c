@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lexer.h"
+
+#define SOURCE_SIZE (32u << 20)
+#define ROUNDS 5
+
+/* Typical code, most runs are shorter than a vector */
+static const char *MIXED[] = {
+    "fun suc nat x -> T ? x + 1 : 0;\n",
+    "fun accumulate nat counter nat limit bool flag ->\n"
+    "    counter < limit & flag = T ? (accumulate counter+1 limit F) : 0;\n",
+    "[ a comment that is long enough to span a couple of simd blocks ]\n",
+    "\t\t    (identifierWithAFairlyLongName 1234567 987654321 F)\n",
+    "T ? (suc 0) + 2 : 0 + 1;\n\n\n",
+    NULL,
+};
+
+/*
+ * Deep indentation, long names and numbers, documented code: the runs the
+ * 16 and 32-byte kernels are for
+ */
+static const char *LONG_RUNS[] = {
+    "                                                                \n"
+    "                                (aVeryLongIdentifierNameThatGoesOnAndOn"
+    "ForQuiteAWhileLongerThanAnyVector 12345678901234567890123456789012345)"
+    "\n",
+    "[ a documentation comment, as long as a paragraph of prose explaining "
+    "what the function below computes, which arguments it expects and what "
+    "it returns once it is done with them ]\n",
+    "fun anotherIdentifierLongEnoughToFillTwoFullVectorsOfBytes nat "
+    "argumentWithADescriptiveNameOfThirtyTwoBytes ->\n"
+    "                                                                "
+    "argumentWithADescriptiveNameOfThirtyTwoBytes;\n",
+    NULL,
+};
+
+static char *synthetic_source(const char **snippets, size_t size) {
+    char *src = (char *)malloc(size + 1);
+    size_t n_snippets = 0;
+    while (snippets[n_snippets] != NULL) {
+        n_snippets++;
+    }
+    size_t len = 0;
+    unsigned seed = 42;
+    while (1) {
+        seed = seed * 1103515245 + 12345;
+        const char *snippet = snippets[(seed >> 16) % n_snippets];
+        size_t snippet_len = strlen(snippet);
+        if (len + snippet_len > size) {
+            break;
+        }
+        memcpy(src + len, snippet, snippet_len);
+        len += snippet_len;
+    }
+    src[len] = '\0';
+    return src;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static const char *simd_name(LexerSimd simd) {
+    switch (simd) {
+        case LEXER_SIMD_OFF:
+            return "bytewise";
+        case LEXER_SIMD_SCALAR:
+            return "scalar";
+        case LEXER_SIMD_SSE2:
+            return "sse2";
+        case LEXER_SIMD_AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+/* Tokenize `src` at every level, speedups are against the bytewise loop */
+static double bench_levels(const char *name, const char *src, size_t len) {
+    LexerSimd levels[] = {LEXER_SIMD_OFF, LEXER_SIMD_SCALAR, LEXER_SIMD_SSE2,
+                          LEXER_SIMD_AVX2};
+    double baseline = 0;
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (lexer_set_simd(levels[i]) != levels[i]) {
+            printf("%-9s %-8s: not supported\n", name, simd_name(levels[i]));
+            continue;
+        }
+        double best = 1e9;
+        size_t n_tokens = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            double begin = now();
+            Lexer *lexer = lexer_new(src);
+            TokenBuffer *tokens = lexer_tokenize_all(lexer);
+            double elapsed = now() - begin;
+            best = elapsed < best ? elapsed : best;
+            n_tokens = tokens->size;
+            destroy_token_buffer(tokens);
+            destroy_lexer(lexer);
+        }
+        if (levels[i] == LEXER_SIMD_OFF) {
+            baseline = best;
+        }
+        printf("%-9s %-8s: %8.1f MB/s %8.2f Mtokens/s %6.2fx\n", name,
+               simd_name(levels[i]), (double)len / best / 1e6,
+               (double)n_tokens / best / 1e6, baseline / best);
+    }
+    return baseline;
+}
+
+int main() {
+    char *long_runs = synthetic_source(LONG_RUNS, SOURCE_SIZE);
+    bench_levels("long-runs", long_runs, strlen(long_runs));
+    free(long_runs);
+
+    char *src = synthetic_source(MIXED, SOURCE_SIZE);
+    size_t len = strlen(src);
+    double baseline = bench_levels("mixed", src, len);
+
+    // chunked lexing with the default kernels, one thread per cpu
+    lexer_set_simd(LEXER_SIMD_AVX2);
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    double best = 1e9;
+    size_t n_tokens = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        double begin = now();
+        TokenBuffer *tokens = lexer_tokenize_parallel(src, len, 0, 0, NULL);
+        double elapsed = now() - begin;
+        best = elapsed < best ? elapsed : best;
+        n_tokens = tokens->size;
+        destroy_token_buffer(tokens);
+    }
+    printf("%-9s %-8s: %8.1f MB/s %8.2f Mtokens/s %6.2fx (%ld threads)\n",
+           "mixed", "parallel", (double)len / best / 1e6,
+           (double)n_tokens / best / 1e6, baseline / best, n_threads);
+    free(src);
+    return 0;
+}
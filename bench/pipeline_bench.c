@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../parser.h"
+#include "../pipeline.h"
+#include "../program_gen.h"
+
+#define ROUNDS 5
+
+/*
+ * Lex and parse valid programs of growing size with the lexer and the parser
+ * interleaved on one thread, then pipelined on two. The trace is off, a run
+ * is the time until the parser accepts: its median and worst over the rounds
+ * are the latency, the median gives the throughput.
+ */
+
+/* A valid program of about `size` bytes, the same on every run */
+static char *synthetic_program(size_t size, size_t *len) {
+    ProgramGenConf conf;
+    program_gen_conf_init(&conf, 42);
+    conf.size = size;
+    return program_gen(&conf, len);
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static ParserState interleaved(SLRParser *parser, const char *src,
+                               size_t len) {
+    Lexer *lexer = lexer_new_n(src, len);
+    lexer_skip_comments(lexer, true);
+    ParserState state;
+    do {
+        TokenView tok = lexer_next_view(lexer);
+        if (tok.ty == Invalid) {
+            state = PARSER_REJECT;
+            break;
+        }
+        state = slr_parser_step(parser, tok);
+    } while (state == PARSER_IDLE);
+    destroy_lexer(lexer);
+    return state;
+}
+
+static ParserState pipelined(SLRParser *parser, const char *src, size_t len) {
+    return slr_parser_parse_pipelined(parser, src, len, NULL, 0, 0, NULL);
+}
+
+static int compare_seconds(const void *l, const void *r) {
+    double a = *(const double *)l, b = *(const double *)r;
+    return (a > b) - (a < b);
+}
+
+int main() {
+    size_t sizes[] = {64u << 10, 1u << 20, 4u << 20, 16u << 20};
+    struct {
+        const char *name;
+        ParserState (*run)(SLRParser *parser, const char *src, size_t len);
+    } variants[] = {
+        {"interleaved", interleaved},
+        {"pipelined", pipelined},
+    };
+    Grammar *g = grammar_new();
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t len;
+        char *src = synthetic_program(sizes[s], &len);
+        double baseline = 0;
+        for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+            double seconds[ROUNDS];
+            for (int round = 0; round < ROUNDS; round++) {
+                SLRParser *parser = slr_parser_init(g, &SLR_TABLE);
+                slr_parser_trace(parser, false);
+                double begin = now();
+                ParserState state = variants[v].run(parser, src, len);
+                double elapsed = now() - begin;
+                destroy_slr_parser(parser);
+                if (state != PARSER_ACCEPT) {
+                    printf("%s: rejected the program\n", variants[v].name);
+                    return 1;
+                }
+                seconds[round] = elapsed;
+            }
+            qsort(seconds, ROUNDS, sizeof(double), compare_seconds);
+            double median = seconds[ROUNDS / 2];
+            baseline = v == 0 ? median : baseline;
+            printf("%6zu KB %-12s: median %9.3f ms, worst %9.3f ms, %8.2f "
+                   "MB/s %6.2fx\n",
+                   len >> 10, variants[v].name, median * 1e3,
+                   seconds[ROUNDS - 1] * 1e3, (double)len / median / 1e6,
+                   baseline / median);
+        }
+        free(src);
+    }
+    destroy_grammar(g);
+    return 0;
+}
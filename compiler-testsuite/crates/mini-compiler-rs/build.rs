@@ -8,7 +8,7 @@ use bindgen::CargoCallbacks;
 fn c_source_files() -> impl Iterator<Item = PathBuf> {
     let source_dir = PathBuf::from("../../../");
     let mut paths = Vec::new();
-    for file in ["lexer.c"] {
+    for file in ["lexer.c", "interner.c", "line_index.c", "arena.c"] {
         paths.push(canonicalize(source_dir.join(file)).unwrap());
     }
     paths.into_iter()
@@ -1,9 +1,13 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "lexer.h"
 #include "parser.h"
+#include "pipeline.h"
+#include "source.h"
 #include "symbol_table.h"
 #ifdef LOG
 #include "log.h"
@@ -26,34 +30,6 @@ char *strcat_copy(const char *str1, const char *str2) {
     return new_str;
 }
 
-char *read_to_string(const char *filename) {
-    FILE *file = fopen(filename, "r");
-
-    if (file == NULL) {
-        printf("Fail to open %s\n", filename);
-        return NULL;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char *buffer = (char *)malloc(file_size + 1);
-
-    if (buffer == NULL) {
-        fclose(file);
-        printf("Memory not enough\n");
-        return NULL;
-    }
-
-    fread(buffer, file_size, 1, file);
-    buffer[file_size] = '\0';
-
-    fclose(file);
-
-    return buffer;
-}
-
 char *add_suffix(const char *filename, const char *suffix) {
     // Check if the input strings are not NULL
     if (filename == NULL || suffix == NULL) {
@@ -85,29 +61,43 @@ char *add_suffix(const char *filename, const char *suffix) {
     }
 }
 
-void parse(char *src, Grammar *g, FILE *fp) {
-    Lexer *lexer = lexer_new(src);
+void parse(const Source *src, Grammar *g, FILE *fp) {
+    // opt-in: the objects of this compile come from one arena
+    Arena *arena = NULL;
+    if (getenv("ARENA") != NULL && strcmp(getenv("ARENA"), "1") == 0) {
+        arena = arena_new(0);
+        arena_enter(arena);
+    }
     SLRParser *parser = slr_parser_init(g, &SLR_TABLE);
+    if (getenv("TRACE") != NULL && strcmp(getenv("TRACE"), "0") == 0) {
+        // opt-out: nothing is recorded, nothing is displayed
+        slr_parser_trace(parser, false);
+    } else if (getenv("TRACE") != NULL &&
+               strcmp(getenv("TRACE"), "stream") == 0) {
+        // opt-in: rows go to the output file only, as the parser runs
+        slr_parser_stream_trace(parser, fp, 0, 0);
+    }
+    TokenBuffer *tokens = NULL;
     ParserState state;
-
-    unsigned line;
-    unsigned col;
-
-    do {
-        Token *tok = lexer_next_token(lexer);
-        line = tok->span->line;
-        col = tok->span->column;
-        if (tok->ty == Comment) {
-            destroy_token(tok);
-            continue;
-        }
-        if (tok->ty == Invalid) {
-            printf("Invalid token at Line %d Column %d\n", line, col);
-            destroy_token(tok);
-            break;
-        }
-        state = slr_parser_step(parser, tok);
-    } while (state == PARSER_IDLE);
+    TokenView last;
+    if (getenv("PIPELINE") != NULL && strcmp(getenv("PIPELINE"), "1") == 0) {
+        // opt-in: a lexer thread feeds the parser while it runs
+        state = slr_parser_parse_pipelined(parser, src->data, src->len, NULL,
+                                           0, 0, &last);
+    } else {
+        // large sources are lexed in chunks on all cpus
+        tokens = lexer_tokenize_parallel(src->data, src->len, 0, 0, NULL);
+        size_t pos;
+        state = slr_parser_parse_buffer(parser, tokens, &pos);
+        last = token_buffer_get(tokens, pos);
+    }
+    // the source is only scanned for lines when an error is reported
+    LineIndex *lines = line_index_new(src->data, src->len);
+    unsigned line, column;
+    if (last.ty == Invalid) {
+        token_view_position(lines, last, &line, &column);
+        printf("Invalid token at Line %d Column %d\n", line, column);
+    }
     if (state == PARSER_ACCEPT) {
         // success
         slr_parser_display_trace(parser, fp);
@@ -115,10 +105,18 @@ void parse(char *src, Grammar *g, FILE *fp) {
     } else {
         // fail
         slr_parser_display_trace(parser, fp);
-        printf("Syntax error at Line %d Column %d\n", line, col);
+        token_view_position(lines, last, &line, &column);
+        printf("Syntax error at Line %d Column %d\n", line, column);
     }
+    destroy_line_index(lines);
     destroy_slr_parser(parser);
-    destroy_lexer(lexer);
+    if (tokens != NULL) {
+        destroy_token_buffer(tokens);
+    }
+    if (arena != NULL) {
+        arena_exit();
+        destroy_arena(arena);
+    }
 }
 
 int main(int argc, char *argv[]) {
@@ -132,13 +130,18 @@ int main(int argc, char *argv[]) {
 #endif
     const char *filename = argv[1];
     char *output_file = add_suffix(filename, "_out");
-    char *src = read_to_string(filename);
+    Source *src = source_open(filename);
     FILE *fp = fopen(output_file, "w");
     Grammar *grammar = grammar_new();
 
-    if (src != NULL) {
+    if (src == NULL) {
+        printf("Fail to open %s\n", filename);
+    } else if (src->len > UINT_MAX) {
+        printf("%s is too large\n", filename);
+        destroy_source(src);
+    } else {
         parse(src, grammar, fp);
-        free(src);
+        destroy_source(src);
     }
 
     fclose(fp);
@@ -0,0 +1,72 @@
+#include "../program_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Size with an optional K, M or G suffix */
+static size_t parse_size(const char* s) {
+    char* end;
+    size_t size = strtoull(s, &end, 10);
+    switch (*end) {
+        case 'K':
+            return size << 10;
+        case 'M':
+            return size << 20;
+        case 'G':
+            return size << 30;
+        default:
+            return size;
+    }
+}
+
+static int usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [--seed N] [--size N[K|M|G]] [--funs N] [--depth N]\n"
+            "          [--comments PERCENT] [--identifiers N]\n"
+            "          [--invalid byte|arrow|truncate]\n",
+            name);
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    ProgramGenConf conf;
+    program_gen_conf_init(&conf, 0);
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            return usage(argv[0]);
+        }
+        const char* value = argv[i + 1];
+        if (strcmp(argv[i], "--seed") == 0) {
+            conf.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--size") == 0) {
+            conf.size = parse_size(value);
+        } else if (strcmp(argv[i], "--funs") == 0) {
+            conf.n_funs = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            conf.depth = strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i], "--comments") == 0) {
+            conf.comment_density = strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i], "--identifiers") == 0) {
+            conf.n_identifiers = strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i], "--invalid") == 0) {
+            conf.valid = false;
+            if (strcmp(value, "byte") == 0) {
+                conf.mutation = MUTATION_INVALID_BYTE;
+            } else if (strcmp(value, "arrow") == 0) {
+                conf.mutation = MUTATION_DROP_ARROW;
+            } else if (strcmp(value, "truncate") == 0) {
+                conf.mutation = MUTATION_TRUNCATE;
+            } else {
+                return usage(argv[0]);
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    size_t len;
+    char* program = program_gen(&conf, &len);
+    fwrite(program, 1, len, stdout);
+    free(program);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "interner.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERNER_INITIAL_CAPACITY 64
+#define INTERNER_INITIAL_ARENA 1024
+
+/* FNV-1a */
+static uint32_t interner_hash(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+Interner *interner_new() {
+    Interner *interner = (Interner *)malloc(sizeof(Interner));
+    interner->arena_size = 0;
+    interner->arena_capacity = INTERNER_INITIAL_ARENA;
+    interner->arena = (char *)malloc(interner->arena_capacity);
+    interner->size = 0;
+    interner->capacity = INTERNER_INITIAL_CAPACITY;
+    interner->offsets =
+        (uint32_t *)malloc(sizeof(uint32_t) * interner->capacity);
+    interner->lens = (uint32_t *)malloc(sizeof(uint32_t) * interner->capacity);
+    interner->hashes =
+        (uint32_t *)malloc(sizeof(uint32_t) * interner->capacity);
+    // the table is kept at most half full
+    interner->n_slots = interner->capacity * 2;
+    interner->slots = (SymbolId *)malloc(sizeof(SymbolId) * interner->n_slots);
+    memset(interner->slots, 0xff, sizeof(SymbolId) * interner->n_slots);
+    return interner;
+}
+
+/* The slot of `name`, or the empty slot it would go to */
+static size_t interner_probe(const Interner *interner, const char *name,
+                             size_t len, uint32_t hash) {
+    size_t mask = interner->n_slots - 1;
+    size_t slot = hash & mask;
+    while (true) {
+        SymbolId id = interner->slots[slot];
+        if (id == SYMBOL_NONE ||
+            (interner->hashes[id] == hash && interner->lens[id] == len &&
+             memcmp(interner->arena + interner->offsets[id], name, len) ==
+                 0)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+static void interner_grow(Interner *interner) {
+    interner->capacity *= 2;
+    size_t capacity = interner->capacity;
+    interner->offsets =
+        (uint32_t *)realloc(interner->offsets, sizeof(uint32_t) * capacity);
+    interner->lens =
+        (uint32_t *)realloc(interner->lens, sizeof(uint32_t) * capacity);
+    interner->hashes =
+        (uint32_t *)realloc(interner->hashes, sizeof(uint32_t) * capacity);
+
+    // rehash with the stored hashes, names are never compared here
+    free(interner->slots);
+    interner->n_slots = capacity * 2;
+    interner->slots = (SymbolId *)malloc(sizeof(SymbolId) * interner->n_slots);
+    memset(interner->slots, 0xff, sizeof(SymbolId) * interner->n_slots);
+    size_t mask = interner->n_slots - 1;
+    for (SymbolId id = 0; id < interner->size; id++) {
+        size_t slot = interner->hashes[id] & mask;
+        while (interner->slots[slot] != SYMBOL_NONE) {
+            slot = (slot + 1) & mask;
+        }
+        interner->slots[slot] = id;
+    }
+}
+
+SymbolId interner_intern(Interner *interner, const char *name, size_t len) {
+    uint32_t hash = interner_hash(name, len);
+    size_t slot = interner_probe(interner, name, len, hash);
+    if (interner->slots[slot] != SYMBOL_NONE) {
+        return interner->slots[slot];
+    }
+
+    if (interner->arena_size + len + 1 > interner->arena_capacity) {
+        while (interner->arena_size + len + 1 > interner->arena_capacity) {
+            interner->arena_capacity *= 2;
+        }
+        interner->arena =
+            (char *)realloc(interner->arena, interner->arena_capacity);
+    }
+    SymbolId id = (SymbolId)interner->size++;
+    interner->offsets[id] = (uint32_t)interner->arena_size;
+    interner->lens[id] = (uint32_t)len;
+    interner->hashes[id] = hash;
+    memcpy(interner->arena + interner->arena_size, name, len);
+    interner->arena[interner->arena_size + len] = '\0';
+    interner->arena_size += len + 1;
+    interner->slots[slot] = id;
+
+    if (interner->size == interner->capacity) {
+        interner_grow(interner);
+    }
+    return id;
+}
+
+SymbolId interner_find(const Interner *interner, const char *name,
+                       size_t len) {
+    uint32_t hash = interner_hash(name, len);
+    return interner->slots[interner_probe(interner, name, len, hash)];
+}
+
+const char *interner_name(const Interner *interner, SymbolId id) {
+    return interner->arena + interner->offsets[id];
+}
+
+size_t interner_len(const Interner *interner, SymbolId id) {
+    return interner->lens[id];
+}
+
+void destroy_interner(Interner *interner) {
+    free(interner->arena);
+    free(interner->offsets);
+    free(interner->lens);
+    free(interner->hashes);
+    free(interner->slots);
+    free(interner);
+}
@@ -0,0 +1,63 @@
+#ifndef MINI_COMPILER_INTERNER_H
+#define MINI_COMPILER_INTERNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Dense id of an interned name, the i-th distinct name gets id i.
+ * Two names are equal iff their ids are.
+ */
+typedef uint32_t SymbolId;
+
+#define SYMBOL_NONE UINT32_MAX /* not a symbol, e.g. a non-identifier token */
+
+/**
+ * Set of distinct names. The bytes of every name live in a single arena,
+ * each followed by a null byte, an open addressing table maps names to ids.
+ */
+typedef struct Interner {
+    char *arena; /* names back to back, each null terminated */
+    size_t arena_size;
+    size_t arena_capacity;
+    uint32_t *offsets; /* id -> offset of the name in the arena */
+    uint32_t *lens;    /* id -> length of the name */
+    uint32_t *hashes;  /* id -> hash of the name */
+    size_t size;       /* number of names */
+    size_t capacity;
+    SymbolId *slots; /* hash table, SYMBOL_NONE if empty */
+    size_t n_slots;  /* power of two */
+} Interner;
+
+Interner *interner_new();
+
+/**
+ * Id of a name, the name is added if it is not in the interner yet
+ * @param interner
+ * @param name pointer to the first byte of the name, not null terminated
+ * @param len length of the name
+ * @return id of the name
+ */
+SymbolId interner_intern(Interner *interner, const char *name, size_t len);
+
+/**
+ * Id of a name without adding it
+ * @param interner
+ * @param name pointer to the first byte of the name, not null terminated
+ * @param len length of the name
+ * @return id of the name, SYMBOL_NONE if it was never interned
+ */
+SymbolId interner_find(const Interner *interner, const char *name, size_t len);
+
+/**
+ * The name of an id, null terminated. The pointer is valid until the next
+ * name is added.
+ * @param interner
+ * @param id
+ * @return the name
+ */
+const char *interner_name(const Interner *interner, SymbolId id);
+size_t interner_len(const Interner *interner, SymbolId id);
+void destroy_interner(Interner *interner);
+
+#endif  // MINI_COMPILER_INTERNER_H
@@ -1,11 +1,16 @@
 #include "lexer.h"
 
-#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "arena.h"
 
 #ifdef LOG
 #include "log.h"
@@ -26,34 +31,265 @@ typedef enum LexerState {
     LEXER_STATE_PENDING,
 } LexerState;
 
-void dfa_reset(DFA *dfa) { dfa->state = dfa->start; };
+/*
+ * ASCII classes of every byte, independent of the locale. Bytes >= 0x80 are
+ * in no class, unlike the <ctype.h> functions they are safe to look up from a
+ * signed char.
+ */
+#define CHAR_SPACE 1 /* ' ' '\t' '\n' '\v' '\f' '\r' */
+#define CHAR_DIGIT 2 /* '0'-'9' */
+#define CHAR_ALPHA 4 /* 'a'-'z' 'A'-'Z' */
 
-void dfa_next(DFA *dfa, char c) {
-    dfa->state = dfa->table[(uint8_t)c][dfa->state];
+static const uint8_t CHAR_FLAGS[256] = {
+    ['\t'] = CHAR_SPACE, ['\n'] = CHAR_SPACE, ['\v'] = CHAR_SPACE,
+    ['\f'] = CHAR_SPACE, ['\r'] = CHAR_SPACE, [' '] = CHAR_SPACE,
+    ['0'] = CHAR_DIGIT,  ['1'] = CHAR_DIGIT,  ['2'] = CHAR_DIGIT,
+    ['3'] = CHAR_DIGIT,  ['4'] = CHAR_DIGIT,  ['5'] = CHAR_DIGIT,
+    ['6'] = CHAR_DIGIT,  ['7'] = CHAR_DIGIT,  ['8'] = CHAR_DIGIT,
+    ['9'] = CHAR_DIGIT,  ['A'] = CHAR_ALPHA,  ['B'] = CHAR_ALPHA,
+    ['C'] = CHAR_ALPHA,  ['D'] = CHAR_ALPHA,  ['E'] = CHAR_ALPHA,
+    ['F'] = CHAR_ALPHA,  ['G'] = CHAR_ALPHA,  ['H'] = CHAR_ALPHA,
+    ['I'] = CHAR_ALPHA,  ['J'] = CHAR_ALPHA,  ['K'] = CHAR_ALPHA,
+    ['L'] = CHAR_ALPHA,  ['M'] = CHAR_ALPHA,  ['N'] = CHAR_ALPHA,
+    ['O'] = CHAR_ALPHA,  ['P'] = CHAR_ALPHA,  ['Q'] = CHAR_ALPHA,
+    ['R'] = CHAR_ALPHA,  ['S'] = CHAR_ALPHA,  ['T'] = CHAR_ALPHA,
+    ['U'] = CHAR_ALPHA,  ['V'] = CHAR_ALPHA,  ['W'] = CHAR_ALPHA,
+    ['X'] = CHAR_ALPHA,  ['Y'] = CHAR_ALPHA,  ['Z'] = CHAR_ALPHA,
+    ['a'] = CHAR_ALPHA,  ['b'] = CHAR_ALPHA,  ['c'] = CHAR_ALPHA,
+    ['d'] = CHAR_ALPHA,  ['e'] = CHAR_ALPHA,  ['f'] = CHAR_ALPHA,
+    ['g'] = CHAR_ALPHA,  ['h'] = CHAR_ALPHA,  ['i'] = CHAR_ALPHA,
+    ['j'] = CHAR_ALPHA,  ['k'] = CHAR_ALPHA,  ['l'] = CHAR_ALPHA,
+    ['m'] = CHAR_ALPHA,  ['n'] = CHAR_ALPHA,  ['o'] = CHAR_ALPHA,
+    ['p'] = CHAR_ALPHA,  ['q'] = CHAR_ALPHA,  ['r'] = CHAR_ALPHA,
+    ['s'] = CHAR_ALPHA,  ['t'] = CHAR_ALPHA,  ['u'] = CHAR_ALPHA,
+    ['v'] = CHAR_ALPHA,  ['w'] = CHAR_ALPHA,  ['x'] = CHAR_ALPHA,
+    ['y'] = CHAR_ALPHA,  ['z'] = CHAR_ALPHA,
 };
 
-bool dfa_is_accept(const DFA *dfa) {
-    bool accept = false;
-    for (unsigned i = 0; i < dfa->n_accepts; i++) {
-        accept |= (dfa->state == dfa->accepts[i]);
+static inline bool ascii_space(char c) {
+    return CHAR_FLAGS[(uint8_t)c] & CHAR_SPACE;
+}
+
+static inline bool ascii_digit(char c) {
+    return CHAR_FLAGS[(uint8_t)c] & CHAR_DIGIT;
+}
+
+static inline bool ascii_alpha(char c) {
+    return CHAR_FLAGS[(uint8_t)c] & CHAR_ALPHA;
+}
+
+static inline bool ascii_alnum(char c) {
+    return CHAR_FLAGS[(uint8_t)c] & (CHAR_DIGIT | CHAR_ALPHA);
+}
+
+/*
+ * Progress of the UTF-8 validation of a comment body, it can be carried over
+ * from one piece of the body to the next.
+ */
+typedef struct Utf8State {
+    uint8_t need; /* continuation bytes still expected */
+    uint8_t lo;   /* range of the next continuation byte */
+    uint8_t hi;
+    bool bad; /* an invalid sequence was seen */
+} Utf8State;
+
+static const Utf8State UTF8_START = {.need = 0, .lo = 0x80, .hi = 0xbf};
+
+/**
+ * Feed one byte of a comment body to the validation, ASCII passes through.
+ * Overlong encodings, surrogates and code points past U+10FFFF are invalid.
+ * @return the state after the byte
+ */
+static inline Utf8State utf8_step(Utf8State state, uint8_t c) {
+    if (state.need > 0) {
+        state.bad |= c < state.lo || c > state.hi;
+        state.need -= 1;
+        state.lo = 0x80;
+        state.hi = 0xbf;
+    } else if (c < 0x80) {
+        // ASCII
+    } else if (c >= 0xc2 && c <= 0xdf) {
+        state.need = 1;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        state.need = 2;
+        state.lo = c == 0xe0 ? 0xa0 : 0x80; /* overlong */
+        state.hi = c == 0xed ? 0x9f : 0xbf; /* surrogates */
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        state.need = 3;
+        state.lo = c == 0xf0 ? 0x90 : 0x80; /* overlong */
+        state.hi = c == 0xf4 ? 0x8f : 0xbf; /* past U+10FFFF */
+    } else {
+        state.bad = true;
     }
-    return accept;
+    return state;
+}
+
+static inline bool utf8_done(Utf8State state) {
+    return !state.bad && state.need == 0;
+}
+
+/*
+ * Character classes of the lexer DFA, bytes of the same class have the same
+ * column in the transition table:
+ * 0 other, 1-9 the single char tokens `? : ; ( ) + & < =`, 10 '-', 11 '>',
+ * 12 '0', 13 '1'-'9', 14 letter, 15 '_', 16 '[', 17 ']'
+ */
+/* clang-format off */
+static const uint8_t LEXER_CLASSES[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  7,  0,  4,  5,  0,  6,  0, 10,  0,  0,
+    12, 13, 13, 13, 13, 13, 13, 13, 13, 13,  2,  3,  8,  9, 11,  1,
+     0, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+    14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 16,  0, 17,  0, 15,
+     0, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+    14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
 };
 
-bool dfa_matches(DFA *dfa, const char *s) {
-    unsigned cursor = 0;
-    while (s[cursor] != '\0') {
-        dfa_next(dfa, s[cursor++]);
+static const uint8_t LEXER_TABLE[DFA_N_CLASSES][DFA_N_STATES] = {
+    {0, 1, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* other */
+    {0, 9, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* ? */
+    {0, 10, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* : */
+    {0, 11, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* ; */
+    {0, 12, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* ( */
+    {0, 13, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* ) */
+    {0, 14, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* + */
+    {0, 15, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* & */
+    {0, 16, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* < */
+    {0, 17, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* = */
+    {0, 3, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* - */
+    {0, 1, 0, 4, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* > */
+    {0, 8, 2, 0, 0, 5, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* 0 */
+    {0, 2, 2, 0, 0, 5, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* 1-9 */
+    {0, 5, 0, 0, 0, 5, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* a-z A-Z */
+    {0, 1, 0, 0, 0, 5, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* _ */
+    {0, 6, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* [ */
+    {0, 1, 0, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, /* ] */
+};
+/* clang-format on */
+
+/*
+ * Token kind of each accept state. Every single char token has a state of its
+ * own (9-17), keywords are accepted as identifiers (5) and told apart by
+ * `keyword_kind`.
+ */
+static const uint8_t LEXER_KINDS[DFA_N_STATES] = {
+    Invalid,      /* dead */
+    Invalid,      /* start */
+    Literal,      /* nonzero natural */
+    Invalid,      /* - */
+    Arrow,        /* -> */
+    Identifier,   /* identifier or keyword */
+    Invalid,      /* inside a comment */
+    Comment,      /* closed comment */
+    Literal,      /* 0 */
+    QuestionMark, /* ? */
+    Colon,        /* : */
+    Semicolon,    /* ; */
+    LeftParen,    /* ( */
+    RightParen,   /* ) */
+    Plus,         /* + */
+    Ampersand,    /* & */
+    Less,         /* < */
+    Equal,        /* = */
+};
+
+const DFA LEXER_DFA = {
+    .classes = LEXER_CLASSES,
+    .table = LEXER_TABLE,
+    .kinds = LEXER_KINDS,
+    .start = 1,
+    .accepts = (1 << 2) | (1 << 4) | (1 << 5) | (1 << 7) | (1 << 8) |
+               (0x1ff << 9),
+};
+
+typedef struct Keyword {
+    const char *text;
+    unsigned len;
+    TokenTy ty;
+} Keyword;
+
+/*
+ * Perfect hash of the keywords, `((first byte >> 1) + len) % 8` maps each of
+ * them to its own slot, an identifier is a keyword iff it equals the keyword
+ * in its slot.
+ */
+static const Keyword KEYWORDS[8] = {
+    [2] = {"nat", 3, NatDecl},
+    [3] = {"T", 1, Literal},
+    [4] = {"F", 1, Literal},
+    [5] = {"bool", 4, BoolDecl},
+    [6] = {"fun", 3, FuncDecl},
+};
+
+static inline TokenTy keyword_kind(const char *lexeme, size_t len) {
+    const Keyword *kw = &KEYWORDS[(((uint8_t)lexeme[0] >> 1) + len) % 8];
+    if (kw->len == len && memcmp(kw->text, lexeme, len) == 0) {
+        return kw->ty;
     }
+    return Identifier;
+}
+
+#ifdef LEXER_DIRECT
+/*
+ * Transitions of LEXER_DFA as code, generated by table/lexer_gen.py. Every
+ * cursor runs LEXER_DFA so the tables of `cursor->dfa` are not looked at.
+ */
+#include "lexer_direct.h"
+
+_Static_assert(LEXER_DIRECT_N_STATES == DFA_N_STATES,
+               "lexer_direct.h is out of date");
+#endif
+
+DFACursor dfa_cursor(const DFA *dfa) {
+    DFACursor cursor = {.dfa = dfa, .state = dfa->start};
+    return cursor;
+}
+
+void dfa_reset(DFACursor *cursor) { cursor->state = cursor->dfa->start; };
+
+void dfa_next(DFACursor *cursor, char c) {
+#ifdef LEXER_DIRECT
+    cursor->state = lexer_direct_next(cursor->state, (uint8_t)c);
+#else
+    const DFA *dfa = cursor->dfa;
+    cursor->state = dfa->table[dfa->classes[(uint8_t)c]][cursor->state];
+#endif
+};
 
-    bool accept = dfa_is_accept(dfa);
-    dfa_reset(dfa);
-    return accept;
+bool dfa_is_accept(const DFACursor *cursor) {
+    return (cursor->dfa->accepts >> cursor->state) & 1;
+};
+
+TokenTy dfa_token_kind(const DFACursor *cursor, const char *lexeme,
+                       size_t len) {
+    TokenTy ty = cursor->dfa->kinds[cursor->state];
+    return ty == Identifier ? keyword_kind(lexeme, len) : ty;
+}
+
+bool dfa_matches(const DFA *dfa, const char *s) {
+    DFACursor cursor = dfa_cursor(dfa);
+#ifdef LEXER_DIRECT
+    lexer_direct_run(s, s + strlen(s), &cursor.state);
+#else
+    for (const char *p = s; *p != '\0'; p++) {
+        dfa_next(&cursor, *p);
+    }
+#endif
+    return dfa_is_accept(&cursor);
 };
 
 Token *eof_token(unsigned start, unsigned end, unsigned line, unsigned col) {
-    Token *token = (Token *)malloc(sizeof(Token));
-    token->lexeme = (char *)malloc(sizeof(char) * 2);
+    Token *token = (Token *)unit_malloc(sizeof(Token));
+    token->lexeme = (char *)unit_malloc(sizeof(char) * 2);
     token->lexeme[0] = '$';
     token->lexeme[1] = '\0';
     token->span = span_new(start, end, line, col);
@@ -61,10 +297,11 @@ Token *eof_token(unsigned start, unsigned end, unsigned line, unsigned col) {
     return token;
 }
 
-int debug_token(Token *token, char *buf, size_t bufsz) {
-    switch (token->ty) {
+static int debug_lexeme(TokenTy ty, const char *lexeme, int len, char *buf,
+                        size_t bufsz) {
+    switch (ty) {
         case Literal: /* Boolean Literal */
-            return snprintf(buf, bufsz, "Literal(%s)", token->lexeme);
+            return snprintf(buf, bufsz, "Literal(%.*s)", len, lexeme);
 
         case BoolDecl: /* The variable type Boolean */
             return snprintf(buf, bufsz, "BoolDecl");
@@ -106,21 +343,32 @@ int debug_token(Token *token, char *buf, size_t bufsz) {
             return snprintf(buf, bufsz, "Token('=')");
 
         case Comment: /* [] */
-            return snprintf(buf, bufsz, "Comment(%s)", token->lexeme);
+            return snprintf(buf, bufsz, "Comment(%.*s)", len, lexeme);
 
         case Identifier: /* Identifier */
-            return snprintf(buf, bufsz, "Ident(%s)", token->lexeme);
+            return snprintf(buf, bufsz, "Ident(%.*s)", len, lexeme);
 
         case Eof: /* End of file */
             return snprintf(buf, bufsz, "EOF");
 
         case Invalid: /* Invalid token */
-            return snprintf(buf, bufsz, "Invalid(%s)", token->lexeme);
+            return snprintf(buf, bufsz, "Invalid(%.*s)", len, lexeme);
     }
 }
 
+int debug_token(Token *token, char *buf, size_t bufsz) {
+    return debug_lexeme(token->ty, token->lexeme, (int)strlen(token->lexeme),
+                        buf, bufsz);
+}
+
+int debug_token_view(const Lexer *lexer, TokenView token, char *buf,
+                     size_t bufsz) {
+    return debug_lexeme(token.ty, lexer_lexeme(lexer, token), (int)token.len,
+                        buf, bufsz);
+}
+
 Span *span_new(unsigned start, unsigned end, unsigned line, unsigned column) {
-    Span *span = (Span *)malloc(sizeof(Span));
+    Span *span = (Span *)unit_malloc(sizeof(Span));
     span->start = start;
     span->end = end;
     span->line = line;
@@ -132,10 +380,18 @@ void destroy_span(Span *span) {
     if (span == NULL) {
         return;
     }
-    free(span);
+    unit_free(span);
 }
 
 TokenTy get_token_type(char *lexeme) {
+    return get_token_type_n(lexeme, strlen(lexeme));
+}
+
+TokenTy get_token_type_n(const char *lexeme, size_t len) {
+    if (len == 0) {
+        return Identifier;
+    }
+
     switch (lexeme[0]) {
         case '?':
             return QuestionMark;
@@ -161,26 +417,10 @@ TokenTy get_token_type(char *lexeme) {
             return Comment;
     }
 
-    if (strcmp(lexeme, "fun") == 0) {
-        return FuncDecl;
-    }
-
-    if (strcmp(lexeme, "T") == 0 || strcmp(lexeme, "F") == 0) {
-        return Literal;
-    }
-
-    if (strcmp(lexeme, "bool") == 0) {
-        return BoolDecl;
-    }
-
-    if (strcmp(lexeme, "nat") == 0) {
-        return NatDecl;
-    }
-
-    if (isdigit(lexeme[0])) {
+    if (ascii_digit(lexeme[0])) {
         return Literal;
     } else {
-        return Identifier;
+        return keyword_kind(lexeme, len);
     }
 }
 
@@ -190,15 +430,15 @@ bool need_to_check_dfa(char cur, char peek, LexerState state) {
         return false;
     }
 
-    if (isalpha(cur)) {
-        return !isalpha(peek) && !isdigit(peek);
+    if (ascii_alpha(cur)) {
+        return !ascii_alnum(peek);
     }
-    if (isdigit(cur)) {
+    if (ascii_digit(cur)) {
         switch (state) {
             case LEXER_STATE_IDENTIFIER:
-                return !isalpha(peek) && !isdigit(peek);
+                return !ascii_alnum(peek);
             case LEXER_STATE_NUMBER:
-                return !isdigit(peek);
+                return !ascii_digit(peek);
             default:
                 log_fatal("unexpected state reached");
                 break;
@@ -214,7 +454,7 @@ bool need_to_check_dfa(char cur, char peek, LexerState state) {
 char *pretty_ascii(char ascii, char *buf, size_t bufsz) {
     if (ascii >= '!') {
         snprintf(buf, bufsz, "%c", ascii);
-    } else if (isspace(ascii) || ascii == '\0') {
+    } else if (ascii_space(ascii) || ascii == '\0') {
         switch (ascii) {
             case 0x0:
                 snprintf(buf, bufsz, "\\0");  // NUL char
@@ -244,62 +484,451 @@ char *pretty_ascii(char ascii, char *buf, size_t bufsz) {
     return buf;
 }
 
-Lexer *lexer_new(const char *src) {
+Lexer *lexer_new(const char *src) { return lexer_new_n(src, strlen(src)); }
+
+Lexer *lexer_new_n(const char *src, unsigned len) {
     Lexer *lexer = malloc(sizeof(Lexer));
 
-    lexer->dfa = &LEXER_DFA;
+    lexer->cursor = dfa_cursor(&LEXER_DFA);
     lexer->start = 0;
     lexer->end = 0;
     lexer->src = src;
-    lexer->len = strlen(src);
-    lexer->line = 1;
-    lexer->column = 1;
+    lexer->len = len;
+    lexer->interner = NULL;
+    lexer->lines = NULL;
+    lexer->skip_comments = false;
+    lexer->on_comment = NULL;
+    lexer->comment_ctx = NULL;
 
     return lexer;
 }
 
-Token *lexer_next_token(Lexer *lexer) {
+void lexer_skip_comments(Lexer *lexer, bool skip) {
+    lexer->skip_comments = skip;
+}
+
+void lexer_on_comment(Lexer *lexer, LexerCommentFn on_comment, void *ctx) {
+    lexer->on_comment = on_comment;
+    lexer->comment_ctx = ctx;
+}
+
+/* The byte at `pos`, the end of the source reads as a null byte */
+static inline char lexer_char_at(const Lexer *lexer, unsigned pos) {
+    return pos < lexer->len ? lexer->src[pos] : '\0';
+}
+
+static TokenView eof_view(const Lexer *lexer) {
+    TokenView token = {
+        .start = lexer->start,
+        .len = lexer->end - lexer->start,
+        .ty = Eof,
+    };
+    return token;
+}
+
+/*
+ * Fast paths of the lexer. At the start of a token the scanner skips a
+ * whole whitespace run, then an identifier/number run or a comment body is
+ * located at once instead of stepping the DFA byte by byte. The kernels
+ * come in scalar, SSE2 and AVX2 flavours and are picked at runtime.
+ */
+typedef struct LexerKernels {
+    /* end of the whitespace run at p */
+    const char *(*skip_space)(const char *p, const char *end);
+    /* end of the [0-9A-Za-z] run at p */
+    const char *(*alnum_run)(const char *p, const char *end);
+    /* end of the [0-9] run at p */
+    const char *(*digit_run)(const char *p, const char *end);
+    /* first ']' or non-ASCII byte at or after p, end if there is none */
+    const char *(*comment_run)(const char *p, const char *end);
+} LexerKernels;
+
+static const char *skip_space_scalar(const char *p, const char *end) {
+    while (p < end && ascii_space(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char *alnum_run_scalar(const char *p, const char *end) {
+    while (p < end && ascii_alnum(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char *digit_run_scalar(const char *p, const char *end) {
+    while (p < end && ascii_digit(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static const char *comment_run_scalar(const char *p, const char *end) {
+    while (p < end && *p != ']' && (uint8_t)*p < 0x80) {
+        p++;
+    }
+    return p;
+}
+
+static const LexerKernels SCALAR_KERNELS = {
+    .skip_space = skip_space_scalar,
+    .alnum_run = alnum_run_scalar,
+    .digit_run = digit_run_scalar,
+    .comment_run = comment_run_scalar,
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define LEXER_HAS_X86_KERNELS
+
+/* lanes where lo <= v <= hi, as unsigned bytes */
+#define SSE2_IN_RANGE(v, lo, hi)                                      \
+    _mm_cmpeq_epi8(                                                   \
+        _mm_min_epu8(_mm_sub_epi8((v), _mm_set1_epi8((char)(lo))),    \
+                     _mm_set1_epi8((char)((hi) - (lo)))),             \
+        _mm_sub_epi8((v), _mm_set1_epi8((char)(lo))))
+
+#define AVX2_IN_RANGE(v, lo, hi)                                          \
+    _mm256_cmpeq_epi8(                                                    \
+        _mm256_min_epu8(_mm256_sub_epi8((v), _mm256_set1_epi8((char)(lo))), \
+                        _mm256_set1_epi8((char)((hi) - (lo)))),           \
+        _mm256_sub_epi8((v), _mm256_set1_epi8((char)(lo))))
+
+static inline __m128i sse2_space(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                        SSE2_IN_RANGE(v, '\t', '\r'));
+}
+
+static inline __m128i sse2_digit(__m128i v) {
+    return SSE2_IN_RANGE(v, '0', '9');
+}
+
+static inline __m128i sse2_alnum(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_or_si128(sse2_digit(v), SSE2_IN_RANGE(lower, 'a', 'z'));
+}
+
+static const char *skip_space_sse2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        uint32_t space = _mm_movemask_epi8(sse2_space(v));
+        if (space != 0xffff) {
+            return p + __builtin_ctz(~space);
+        }
+    }
+    return skip_space_scalar(p, end);
+}
+
+static const char *alnum_run_sse2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        uint32_t alnum = _mm_movemask_epi8(sse2_alnum(v));
+        if (alnum != 0xffff) {
+            return p + __builtin_ctz(~alnum);
+        }
+    }
+    return alnum_run_scalar(p, end);
+}
+
+static const char *digit_run_sse2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        uint32_t digit = _mm_movemask_epi8(sse2_digit(v));
+        if (digit != 0xffff) {
+            return p + __builtin_ctz(~digit);
+        }
+    }
+    return digit_run_scalar(p, end);
+}
+
+static const char *comment_run_sse2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        // the sign bits are the non-ASCII bytes
+        uint32_t stop =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(']'))) |
+            _mm_movemask_epi8(v);
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return comment_run_scalar(p, end);
+}
+
+static const LexerKernels SSE2_KERNELS = {
+    .skip_space = skip_space_sse2,
+    .alnum_run = alnum_run_sse2,
+    .digit_run = digit_run_sse2,
+    .comment_run = comment_run_sse2,
+};
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2_space(__m256i v) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                           AVX2_IN_RANGE(v, '\t', '\r'));
+}
+
+AVX2 static inline __m256i avx2_digit(__m256i v) {
+    return AVX2_IN_RANGE(v, '0', '9');
+}
+
+AVX2 static inline __m256i avx2_alnum(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(avx2_digit(v), AVX2_IN_RANGE(lower, 'a', 'z'));
+}
+
+AVX2 static const char *skip_space_avx2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        uint32_t space = _mm256_movemask_epi8(avx2_space(v));
+        if (space != 0xffffffff) {
+            return p + __builtin_ctz(~space);
+        }
+    }
+    return skip_space_sse2(p, end);
+}
+
+AVX2 static const char *alnum_run_avx2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        uint32_t alnum = _mm256_movemask_epi8(avx2_alnum(v));
+        if (alnum != 0xffffffff) {
+            return p + __builtin_ctz(~alnum);
+        }
+    }
+    return alnum_run_sse2(p, end);
+}
+
+AVX2 static const char *digit_run_avx2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        uint32_t digit = _mm256_movemask_epi8(avx2_digit(v));
+        if (digit != 0xffffffff) {
+            return p + __builtin_ctz(~digit);
+        }
+    }
+    return digit_run_sse2(p, end);
+}
+
+AVX2 static const char *comment_run_avx2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        uint32_t stop = _mm256_movemask_epi8(
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(']'))) |
+                        _mm256_movemask_epi8(v);
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+    }
+    return comment_run_sse2(p, end);
+}
+
+static const LexerKernels AVX2_KERNELS = {
+    .skip_space = skip_space_avx2,
+    .alnum_run = alnum_run_avx2,
+    .digit_run = digit_run_avx2,
+    .comment_run = comment_run_avx2,
+};
+#endif  // __x86_64__ || __i386__
+
+static LexerSimd LEXER_SIMD = LEXER_SIMD_SCALAR;
+static const LexerKernels *LEXER_KERNELS = &SCALAR_KERNELS;
+
+/* Pick the widest kernels supported by the cpu */
+__attribute__((constructor)) static void lexer_simd_detect() {
+    lexer_set_simd(LEXER_SIMD_AVX2);
+}
+
+LexerSimd lexer_set_simd(LexerSimd simd) {
+#ifdef LEXER_HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (simd == LEXER_SIMD_AVX2 && !__builtin_cpu_supports("avx2")) {
+        simd = LEXER_SIMD_SSE2;
+    }
+    if (simd == LEXER_SIMD_SSE2 && !__builtin_cpu_supports("sse2")) {
+        simd = LEXER_SIMD_SCALAR;
+    }
+#else
+    if (simd > LEXER_SIMD_SCALAR) {
+        simd = LEXER_SIMD_SCALAR;
+    }
+#endif
+    switch (simd) {
+        case LEXER_SIMD_OFF:
+        case LEXER_SIMD_SCALAR:
+            LEXER_KERNELS = &SCALAR_KERNELS;
+            break;
+#ifdef LEXER_HAS_X86_KERNELS
+        case LEXER_SIMD_SSE2:
+            LEXER_KERNELS = &SSE2_KERNELS;
+            break;
+        case LEXER_SIMD_AVX2:
+            LEXER_KERNELS = &AVX2_KERNELS;
+            break;
+#endif
+        default:
+            break;
+    }
+    LEXER_SIMD = simd;
+    return simd;
+}
+
+LexerSimd lexer_get_simd() { return LEXER_SIMD; }
+
+/**
+ * Find the ']' closing a comment and validate the body before it in the same
+ * pass, the kernel skips the ASCII and stops on the bytes of a sequence.
+ * @return the first ']' at or after p, end if there is none
+ */
+static const char *utf8_find_bracket(Utf8State *state, const char *p,
+                                     const char *end) {
+    while (p < end) {
+        if (state->need == 0) {
+            p = LEXER_KERNELS->comment_run(p, end);
+            if (p == end || *p == ']') {
+                break;
+            }
+        } else if (*p == ']') {
+            // a truncated sequence, `utf8_done` sees the missing bytes
+            break;
+        }
+        *state = utf8_step(*state, *p++);
+    }
+    return p;
+}
+
+/**
+ * Try to scan the next token on the fast path.
+ * Whitespace before the token is always consumed, then the token is
+ * scanned against the end pointer of the source: its length is known from
+ * its first bytes (or a kernel run), so there is a single bounds check per
+ * token instead of one per byte. Null bytes are left to the DFA loop.
+ * @return true if `token` is filled, false to fall back to the DFA loop
+ */
+static inline bool lexer_scan_fast(Lexer *lexer, TokenView *token) {
+    const char *src = lexer->src;
+    const char *end = src + lexer->len;
+    const char *p = src + lexer->start;
+    Utf8State body = UTF8_START; /* of a comment */
+
+    // most tokens are separated by a single space or none at all, check the
+    // first bytes inline before calling into a kernel
+    const char *q = p;
+    if (q < end && *q == ' ') {
+        q++;
+    }
+    if (q < end && ascii_space(*q)) {
+        q = LEXER_KERNELS->skip_space(q, end);
+    }
+    if (q != p) {
+        lexer->start = q - src;
+        lexer->end = lexer->start;
+    }
+    if (q == end) {
+        return false;
+    }
+
+    // The identifier (5) and number (2) states of the DFA loop on the rest
+    // of their run, and the comment state (6) loops on everything but ']'.
+    // Feeding the first two bytes is enough to settle the final state.
+    const char *r = q + 1;
+    if (ascii_alnum(*q) && !ascii_digit(*q)) {
+        if (r < end && ascii_alnum(*r)) {
+            r = LEXER_KERNELS->alnum_run(r + 1, end);
+        }
+        dfa_next(&lexer->cursor, q[0]);
+        if (r - q > 1) {
+            dfa_next(&lexer->cursor, q[1]);
+        }
+    } else if (ascii_digit(*q)) {
+        if (r < end && ascii_digit(*r)) {
+            r = LEXER_KERNELS->digit_run(r + 1, end);
+        }
+        dfa_next(&lexer->cursor, q[0]);
+        if (r - q > 1) {
+            dfa_next(&lexer->cursor, q[1]);
+        }
+    } else if (*q == '[') {
+        r = utf8_find_bracket(&body, r, end);
+        dfa_next(&lexer->cursor, q[0]);
+        if (r == end) {
+            // unterminated comment, swallow the rest including the null byte
+            unsigned rest = lexer->len + 1 - lexer->start;
+            dfa_next(&lexer->cursor, '\0');
+            lexer->end += rest;
+            *token = eof_view(lexer);
+            return true;
+        }
+        dfa_next(&lexer->cursor, *r);
+        r += 1;
+    } else if (*q != '\0') {
+        // anything else is a single byte, but for the '-' of an arrow
+        dfa_next(&lexer->cursor, q[0]);
+        if (*q == '-' && r < end && *r == '>') {
+            dfa_next(&lexer->cursor, *r);
+            r += 1;
+        }
+    } else {
+        return false;
+    }
+
+    token->start = lexer->start;
+    token->len = r - q;
+    token->ty = dfa_token_kind(&lexer->cursor, q, token->len);
+    if (token->ty == Comment && !utf8_done(body)) {
+        token->ty = Invalid;
+    }
+    dfa_reset(&lexer->cursor);
+    lexer->start += token->len;
+    lexer->end = lexer->start;
+    return true;
+}
+
+static inline TokenView lexer_scan_token(Lexer *lexer) {
     log_debug("Getting next token, start from %u", lexer->start);
 
     if (lexer->start > lexer->len) {
         log_info("EOF reached");
-        return eof_token(lexer->start, lexer->end, lexer->line, lexer->column);
+        return eof_view(lexer);
+    }
+
+    if (LEXER_SIMD != LEXER_SIMD_OFF) {
+        TokenView token;
+        if (lexer_scan_fast(lexer, &token)) {
+            return token;
+        }
     }
 
     unsigned cursor = lexer->start;
     LexerState state = LEXER_STATE_PENDING;
+    Utf8State body = UTF8_START; /* of a comment */
     while (cursor <= lexer->len) {
+        char cur = lexer_char_at(lexer, cursor);
         if (state == LEXER_STATE_PENDING) {
-            if (lexer->src[cursor] == '[') {
+            if (cur == '[') {
                 state = LEXER_STATE_COMMENT;
             }
 
-            if (isdigit(lexer->src[cursor])) {
+            if (ascii_digit(cur)) {
                 state = LEXER_STATE_NUMBER;
             }
 
-            if (isalpha(lexer->src[cursor])) {
+            if (ascii_alpha(cur)) {
                 state = LEXER_STATE_IDENTIFIER;
             }
         }
         char buf[8];
         log_debug("Cursor at src[%u] = [%s]", cursor,
-                  pretty_ascii(lexer->src[cursor], buf, 8));
-        char peek = cursor + 1 < lexer->len ? lexer->src[cursor + 1] : '\0';
+                  pretty_ascii(cur, buf, 8));
+        char peek = lexer_char_at(lexer, cursor + 1);
         log_debug("Peek   at src[%u] = [%s]", cursor + 1,
                   pretty_ascii(peek, buf, 8));
         // Don't skip whitespace in comment section
         if (state != LEXER_STATE_COMMENT &&
-            (isspace(lexer->src[cursor]) || lexer->src[cursor] == '\0')) {
-            // Bump the lineno
-            if (lexer->src[cursor] == '\n') {
-                lexer->line += 1;
-                lexer->column = 1;
-                log_debug("Column Reset to 1");
-            } else {
-                lexer->column += 1;
-                log_debug("Column Bumped");
-            }
+            (ascii_space(cur) || cur == '\0')) {
             log_debug("Whitespace detected at %u, Skip", cursor);
             cursor += 1;
             // reset span
@@ -307,55 +936,696 @@ Token *lexer_next_token(Lexer *lexer) {
             lexer->end = cursor;
         } else {
             // feed the current char to dfa
-            dfa_next(lexer->dfa, lexer->src[cursor]);
+            dfa_next(&lexer->cursor, cur);
+            if (state == LEXER_STATE_COMMENT && cur != ']') {
+                body = utf8_step(body, cur);
+            }
             // if next char is whitespace or '\0'
             // which indicates current token is done
-            if (need_to_check_dfa(lexer->src[cursor], peek, state)) {
+            if (need_to_check_dfa(cur, peek, state)) {
                 log_debug(
                     "DFA checking condition satisfied, check DFA to decide "
                     "whether to accept");
 
-                Token *token = (Token *)malloc(sizeof(Token));
-                unsigned token_len = lexer->end - lexer->start + 1;
-                char *lexeme = (char *)malloc(sizeof(char) * (token_len + 1));
-                token->lexeme =
-                    strncpy(lexeme, lexer->src + lexer->start, token_len);
-                token->lexeme[token_len] = '\0';
-                token->span =
-                    span_new(lexer->start, lexer->end, lexer->line,
-                             lexer->column - (lexer->end - lexer->start));
-
-                if (dfa_is_accept(lexer->dfa)) {
-                    token->ty = get_token_type(token->lexeme);
-                    log_debug("accept:「%s」 => span(%u, %u)", token->lexeme,
-                              lexer->start, lexer->end);
+                TokenView token = {
+                    .start = lexer->start,
+                    .len = lexer->end - lexer->start + 1,
+                };
+
+                token.ty = dfa_token_kind(&lexer->cursor,
+                                          lexer->src + token.start, token.len);
+                if (token.ty == Comment && !utf8_done(body)) {
+                    token.ty = Invalid;
+                }
+                if (token.ty != Invalid) {
+                    log_debug("accept:「%.*s」 => span(%u, %u)", token.len,
+                              lexer->src + token.start, lexer->start,
+                              lexer->end);
                 } else {
-                    token->ty = Invalid;
                     log_warn("The lexeme is rejected by the DFA");
                 }
-                dfa_reset(lexer->dfa);
+                dfa_reset(&lexer->cursor);
                 lexer->start = lexer->end + 1;
                 lexer->end = lexer->start;
-                lexer->column += 1;
-                log_debug("Column Bumped");
                 return token;
             } else {
                 lexer->end += 1;
-                lexer->column += 1;
-                log_debug("Column Bumped");
             }
 
             cursor += 1;
         }
     }
 
-    return eof_token(lexer->start, lexer->end, lexer->line, lexer->column);
+    return eof_view(lexer);
+}
+
+/* Scan the next token, shared by the pull and the batch interfaces */
+static inline TokenView lexer_scan(Lexer *lexer) {
+    TokenView token = lexer_scan_token(lexer);
+    while (token.ty == Comment) {
+        if (lexer->on_comment != NULL) {
+            lexer->on_comment(lexer->comment_ctx, token.start, token.len);
+        }
+        if (!lexer->skip_comments) {
+            break;
+        }
+        token = lexer_scan_token(lexer);
+    }
+    token.symbol = SYMBOL_NONE;
+    if (lexer->interner != NULL && token.ty == Identifier) {
+        token.symbol = interner_intern(lexer->interner,
+                                       lexer->src + token.start, token.len);
+    }
+    return token;
+}
+
+TokenView lexer_next_view(Lexer *lexer) { return lexer_scan(lexer); }
+
+const char *lexer_lexeme(const Lexer *lexer, TokenView token) {
+    return lexer->src + token.start;
+}
+
+Token *lexer_next_token(Lexer *lexer) {
+    TokenView view = lexer_next_view(lexer);
+    if (lexer->lines == NULL) {
+        lexer->lines = line_index_new(lexer->src, lexer->len);
+    }
+    unsigned line, column;
+    token_view_position(lexer->lines, view, &line, &column);
+    if (view.ty == Eof) {
+        return eof_token(view.start, view.start + view.len, line, column);
+    }
+
+    Token *token = (Token *)unit_malloc(sizeof(Token));
+    token->lexeme = (char *)unit_malloc(sizeof(char) * (view.len + 1));
+    memcpy(token->lexeme, lexer_lexeme(lexer, view), view.len);
+    token->lexeme[view.len] = '\0';
+    token->span =
+        span_new(view.start, view.start + view.len - 1, line, column);
+    token->ty = view.ty;
+    return token;
 }
 
 void destroy_token(Token *token) {
     destroy_span(token->span);
-    free(token->lexeme);
-    free(token);
+    unit_free(token->lexeme);
+    unit_free(token);
+}
+
+void token_view_position(LineIndex *lines, TokenView token, unsigned *line,
+                         unsigned *column) {
+    unsigned offset = token.ty == Eof ? token.start + token.len : token.start;
+    line_index_lookup(lines, offset, line, column);
+}
+
+void destroy_lexer(Lexer *lexer) {
+    if (lexer->lines != NULL) {
+        destroy_line_index(lexer->lines);
+    }
+    free(lexer);
+}
+
+TokenBuffer *token_buffer_new(size_t capacity) {
+    TokenBuffer *tokens = (TokenBuffer *)malloc(sizeof(TokenBuffer));
+    tokens->size = 0;
+    tokens->capacity = capacity > 0 ? capacity : 16;
+    tokens->ty = (uint8_t *)malloc(sizeof(uint8_t) * tokens->capacity);
+    tokens->start = (uint32_t *)malloc(sizeof(uint32_t) * tokens->capacity);
+    tokens->len = (uint32_t *)malloc(sizeof(uint32_t) * tokens->capacity);
+    tokens->symbol = (SymbolId *)malloc(sizeof(SymbolId) * tokens->capacity);
+    tokens->interner = NULL;
+    tokens->skip_comments = false;
+    tokens->on_comment = NULL;
+    tokens->comment_ctx = NULL;
+    return tokens;
+}
+
+void token_buffer_reserve(TokenBuffer *tokens, size_t capacity) {
+    if (capacity <= tokens->capacity) {
+        return;
+    }
+    tokens->capacity = capacity;
+    tokens->ty = (uint8_t *)realloc(tokens->ty, sizeof(uint8_t) * capacity);
+    tokens->start =
+        (uint32_t *)realloc(tokens->start, sizeof(uint32_t) * capacity);
+    tokens->len = (uint32_t *)realloc(tokens->len, sizeof(uint32_t) * capacity);
+    tokens->symbol =
+        (SymbolId *)realloc(tokens->symbol, sizeof(SymbolId) * capacity);
+}
+
+void token_buffer_push(TokenBuffer *tokens, TokenView token) {
+    if (tokens->size == tokens->capacity) {
+        token_buffer_reserve(tokens, tokens->capacity * 2);
+    }
+    size_t i = tokens->size++;
+    tokens->ty[i] = (uint8_t)token.ty;
+    tokens->start[i] = token.start;
+    tokens->len[i] = token.len;
+    tokens->symbol[i] = token.symbol;
+}
+
+TokenView token_buffer_get(const TokenBuffer *tokens, size_t i) {
+    TokenView token = {
+        .start = tokens->start[i],
+        .len = tokens->len[i],
+        .symbol = tokens->symbol[i],
+        .ty = (TokenTy)tokens->ty[i],
+    };
+    return token;
+}
+
+void destroy_token_buffer(TokenBuffer *tokens) {
+    free(tokens->ty);
+    free(tokens->start);
+    free(tokens->len);
+    free(tokens->symbol);
+    free(tokens);
 }
 
-void destroy_lexer(Lexer *lexer) { free(lexer); }
+TokenBuffer *lexer_tokenize_all(Lexer *lexer) {
+    // a rough guess of one token every four bytes avoids most regrowth
+    unsigned rest = lexer->start < lexer->len ? lexer->len - lexer->start : 0;
+    TokenBuffer *tokens = token_buffer_new(rest / 4 + 16);
+    tokens->interner = lexer->interner;
+    tokens->skip_comments = lexer->skip_comments;
+    tokens->on_comment = lexer->on_comment;
+    tokens->comment_ctx = lexer->comment_ctx;
+    TokenView token;
+    do {
+        token = lexer_scan(lexer);
+        token_buffer_push(tokens, token);
+    } while (token.ty != Eof);
+    return tokens;
+}
+
+/*
+ * Parallel lexing. The source is cut at whitespace outside comments, where
+ * the sequential lexer is never inside a token, and the chunks are lexed
+ * independently. Tokens only carry offsets into the whole source, so the
+ * chunks are simply concatenated.
+ */
+
+#define PARALLEL_DEFAULT_CHUNK_SIZE (1u << 20)
+
+typedef struct LexChunk {
+    unsigned start;      /* first byte of the chunk */
+    unsigned end;        /* one past the last byte of the chunk */
+    TokenBuffer *tokens; /* tokens of the chunk, ends with Eof */
+    size_t offset;       /* index of the first token in the output */
+} LexChunk;
+
+typedef struct LexPool {
+    const char *src;
+    LexChunk *chunks;
+    size_t n_chunks;
+    atomic_size_t next; /* next chunk to pick up */
+    TokenBuffer *out;
+    void (*work)(struct LexPool *pool, LexChunk *chunk);
+} LexPool;
+
+/**
+ * Find the first whitespace at or after `target` which is outside comments
+ * @param src
+ * @param len
+ * @param cursor a position outside comments before `target`, moved forward
+ * @param target
+ * @return the split point, `len` if there is none
+ */
+static unsigned next_split(const char *src, unsigned len, unsigned *cursor,
+                           unsigned target) {
+    unsigned p = *cursor;
+    while (p < len) {
+        if (src[p] == '[') {
+            const char *close = memchr(src + p + 1, ']', len - p - 1);
+            if (close == NULL) {
+                // unterminated comment, it runs to the end of the source
+                return len;
+            }
+            p = close - src + 1;
+        } else if (p < target) {
+            const char *open = memchr(src + p, '[', target - p);
+            p = open != NULL ? (unsigned)(open - src) : target;
+        } else if (ascii_space(src[p])) {
+            *cursor = p;
+            return p;
+        } else {
+            p++;
+        }
+    }
+    return len;
+}
+
+static void lex_chunk(LexPool *pool, LexChunk *chunk) {
+    Lexer lexer = {
+        .cursor = dfa_cursor(&LEXER_DFA),
+        .start = chunk->start,
+        .end = chunk->start,
+        .src = pool->src,
+        .len = chunk->end,
+    };
+    chunk->tokens = lexer_tokenize_all(&lexer);
+}
+
+/* Copy the tokens of a chunk to the output */
+static void stitch_chunk(LexPool *pool, LexChunk *chunk) {
+    const TokenBuffer *tokens = chunk->tokens;
+    TokenBuffer *out = pool->out;
+    // the Eof of a chunk is only kept for the last one
+    size_t n = chunk == &pool->chunks[pool->n_chunks - 1] ? tokens->size
+                                                            : tokens->size - 1;
+    size_t at = chunk->offset;
+    memcpy(out->ty + at, tokens->ty, sizeof(uint8_t) * n);
+    memcpy(out->start + at, tokens->start, sizeof(uint32_t) * n);
+    memcpy(out->len + at, tokens->len, sizeof(uint32_t) * n);
+    memcpy(out->symbol + at, tokens->symbol, sizeof(SymbolId) * n);
+    destroy_token_buffer(chunk->tokens);
+    chunk->tokens = NULL;
+}
+
+static void *lex_pool_worker(void *arg) {
+    LexPool *pool = (LexPool *)arg;
+    while (true) {
+        size_t i = atomic_fetch_add(&pool->next, 1);
+        if (i >= pool->n_chunks) {
+            return NULL;
+        }
+        pool->work(pool, &pool->chunks[i]);
+    }
+}
+
+/* Run `work` on every chunk with `n_threads` threads (caller included) */
+static void lex_pool_run(LexPool *pool, unsigned n_threads,
+                         void (*work)(LexPool *pool, LexChunk *chunk)) {
+    pool->work = work;
+    atomic_store(&pool->next, 0);
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * n_threads);
+    unsigned spawned = 0;
+    for (; spawned + 1 < n_threads; spawned++) {
+        if (pthread_create(&threads[spawned], NULL, lex_pool_worker, pool)) {
+            break;
+        }
+    }
+    lex_pool_worker(pool);
+    for (unsigned i = 0; i < spawned; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+/* Intern the identifiers of a buffer lexed without an interner */
+static void token_buffer_intern(TokenBuffer *tokens, const char *src,
+                                Interner *interner) {
+    tokens->interner = interner;
+    for (size_t i = 0; i < tokens->size; i++) {
+        if (tokens->ty[i] == Identifier) {
+            tokens->symbol[i] = interner_intern(
+                interner, src + tokens->start[i], tokens->len[i]);
+        }
+    }
+}
+
+TokenBuffer *lexer_tokenize_parallel(const char *src, unsigned len,
+                                     unsigned n_threads, unsigned chunk_size,
+                                     Interner *interner) {
+    if (n_threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = online > 0 ? (unsigned)online : 1;
+    }
+    if (chunk_size == 0) {
+        chunk_size = PARALLEL_DEFAULT_CHUNK_SIZE;
+    }
+    if (n_threads == 1 || len <= chunk_size) {
+        LexPool pool = {.src = src};
+        LexChunk whole = {.start = 0, .end = len};
+        lex_chunk(&pool, &whole);
+        if (interner != NULL) {
+            token_buffer_intern(whole.tokens, src, interner);
+        }
+        return whole.tokens;
+    }
+
+    // pre-scan for the split points
+    size_t capacity = len / chunk_size + 1;
+    LexChunk *chunks = (LexChunk *)malloc(sizeof(LexChunk) * capacity);
+    size_t n_chunks = 0;
+    unsigned cursor = 0;
+    unsigned start = 0;
+    while (start < len) {
+        unsigned target = len - start > chunk_size ? start + chunk_size : len;
+        unsigned end = next_split(src, len, &cursor, target);
+        chunks[n_chunks++] = (LexChunk){.start = start, .end = end};
+        start = end;
+    }
+    if (n_chunks == 0) {
+        chunks[n_chunks++] = (LexChunk){.start = 0, .end = len};
+    }
+    log_debug("Source of %u bytes split into %zu chunks", len, n_chunks);
+
+    LexPool pool = {.src = src, .chunks = chunks, .n_chunks = n_chunks};
+    lex_pool_run(&pool, n_threads, lex_chunk);
+
+    // place the chunks, all but the last one drop their Eof
+    size_t n_tokens = 1;
+    for (size_t i = 0; i < n_chunks; i++) {
+        chunks[i].offset = n_tokens - 1;
+        n_tokens += chunks[i].tokens->size - 1;
+    }
+
+    pool.out = token_buffer_new(n_tokens);
+    pool.out->size = n_tokens;
+    lex_pool_run(&pool, n_threads, stitch_chunk);
+    free(chunks);
+    // the interner is not shared between threads, ids are given in order
+    if (interner != NULL) {
+        token_buffer_intern(pool.out, src, interner);
+    }
+    return pool.out;
+}
+
+/*
+ * Incremental re-lexing. The lexer keeps no state across a token boundary
+ * besides its position, so lexing restarts at the end of the last token the
+ * edit can't have changed (neither its bytes nor the byte after it) and stops
+ * as soon as a new token starts where a shifted old one did: every token
+ * after that point is the old one, moved.
+ */
+
+/* Index of the first token which ends at or after `offset` */
+static size_t token_buffer_first_ending_at(const TokenBuffer *tokens,
+                                           unsigned offset) {
+    size_t lo = 0;
+    size_t hi = tokens->size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tokens->start[mid] + tokens->len[mid] < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+size_t lexer_relex(TokenBuffer *tokens, const char *src, unsigned len,
+                   LexEdit edit) {
+    long delta = (long)edit.inserted - (long)edit.deleted;
+    size_t first = token_buffer_first_ending_at(tokens, edit.offset);
+
+    Lexer *lexer = lexer_new_n(src, len);
+    lexer->interner = tokens->interner;
+    lexer_skip_comments(lexer, tokens->skip_comments);
+    lexer_on_comment(lexer, tokens->on_comment, tokens->comment_ctx);
+    if (first > 0) {
+        TokenView last = token_buffer_get(tokens, first - 1);
+        lexer->start = last.start + last.len;
+        lexer->end = lexer->start;
+    }
+
+    // re-lex until a token starts past the edit where an old one started
+    TokenBuffer *fresh = token_buffer_new(16);
+    size_t old = first;
+    TokenView token;
+    while (true) {
+        token = lexer_scan(lexer);
+        if (token.start >= edit.offset + edit.inserted) {
+            while (old < tokens->size &&
+                   (long)tokens->start[old] + delta < (long)token.start) {
+                old++;
+            }
+            if (old < tokens->size &&
+                tokens->start[old] >= edit.offset + edit.deleted &&
+                (long)tokens->start[old] + delta == (long)token.start) {
+                break;
+            }
+        }
+        token_buffer_push(fresh, token);
+        if (token.ty == Eof) {
+            old = tokens->size;
+            break;
+        }
+    }
+    destroy_lexer(lexer);
+    log_debug("Re-lexed %zu tokens, resynchronized at %zu", fresh->size, old);
+
+    // splice: tokens[first, old) are replaced by the fresh ones
+    size_t tail = tokens->size - old;
+    size_t size = first + fresh->size + tail;
+    token_buffer_reserve(tokens, size);
+    size_t to = first + fresh->size;
+    memmove(tokens->ty + to, tokens->ty + old, sizeof(uint8_t) * tail);
+    memmove(tokens->start + to, tokens->start + old, sizeof(uint32_t) * tail);
+    memmove(tokens->len + to, tokens->len + old, sizeof(uint32_t) * tail);
+    memmove(tokens->symbol + to, tokens->symbol + old,
+            sizeof(SymbolId) * tail);
+    memcpy(tokens->ty + first, fresh->ty, sizeof(uint8_t) * fresh->size);
+    memcpy(tokens->start + first, fresh->start,
+           sizeof(uint32_t) * fresh->size);
+    memcpy(tokens->len + first, fresh->len, sizeof(uint32_t) * fresh->size);
+    memcpy(tokens->symbol + first, fresh->symbol,
+           sizeof(SymbolId) * fresh->size);
+    tokens->size = size;
+
+    // shift the moved tokens
+    for (size_t i = to; i < size; i++) {
+        tokens->start[i] += delta;
+    }
+
+    size_t relexed = fresh->size;
+    destroy_token_buffer(fresh);
+    return relexed;
+}
+
+/*
+ * Streaming lexer. Tokens are scanned in the buffer, when one runs off its
+ * end the buffer is compacted to the start of the token and refilled. A token
+ * longer than the whole buffer is scanned on without keeping its lexeme.
+ */
+
+#define STREAM_NO_MARK SIZE_MAX
+
+static StreamLexer *stream_lexer_new(int fd, FILE *file, size_t capacity) {
+    if (capacity == 0) {
+        capacity = STREAM_LEXER_DEFAULT_CAPACITY;
+    } else if (capacity < STREAM_LEXER_MIN_CAPACITY) {
+        capacity = STREAM_LEXER_MIN_CAPACITY;
+    }
+    StreamLexer *lexer = (StreamLexer *)malloc(sizeof(StreamLexer));
+    lexer->cursor = dfa_cursor(&LEXER_DFA);
+    lexer->fd = fd;
+    lexer->file = file;
+    lexer->buf = (char *)malloc(capacity);
+    lexer->capacity = capacity;
+    lexer->size = 0;
+    lexer->pos = 0;
+    lexer->offset = 0;
+    lexer->line = 1;
+    lexer->column = 1;
+    lexer->drained = false;
+    lexer->finished = false;
+    lexer->error = 0;
+    return lexer;
+}
+
+StreamLexer *stream_lexer_new_fd(int fd, size_t capacity) {
+    return stream_lexer_new(fd, NULL, capacity);
+}
+
+StreamLexer *stream_lexer_new_file(FILE *file, size_t capacity) {
+    return stream_lexer_new(-1, file, capacity);
+}
+
+void destroy_stream_lexer(StreamLexer *lexer) {
+    free(lexer->buf);
+    free(lexer);
+}
+
+static size_t stream_read(StreamLexer *lexer, char *buf, size_t n) {
+    if (lexer->file != NULL) {
+        size_t got = fread(buf, 1, n, lexer->file);
+        if (got == 0 && ferror(lexer->file)) {
+            lexer->error = errno;
+        }
+        return got;
+    }
+    while (true) {
+        ssize_t got = read(lexer->fd, buf, n);
+        if (got >= 0) {
+            return got;
+        }
+        if (errno != EINTR) {
+            lexer->error = errno;
+            return 0;
+        }
+    }
+}
+
+/**
+ * Drop the bytes before `*mark` (before the cursor if there is no mark) and
+ * read more input behind the rest. If the marked token already fills the
+ * whole buffer its mark is dropped.
+ * @param lexer
+ * @param mark start of the current token in the buffer, or STREAM_NO_MARK
+ * @return false if the source is drained
+ */
+static bool stream_refill(StreamLexer *lexer, size_t *mark) {
+    if (lexer->drained) {
+        return false;
+    }
+    if (*mark == 0 && lexer->size == lexer->capacity) {
+        log_debug("Token longer than the buffer, lexeme dropped");
+        *mark = STREAM_NO_MARK;
+    }
+    size_t keep = *mark == STREAM_NO_MARK ? lexer->pos : *mark;
+    memmove(lexer->buf, lexer->buf + keep, lexer->size - keep);
+    lexer->offset += keep;
+    lexer->size -= keep;
+    lexer->pos -= keep;
+    if (*mark != STREAM_NO_MARK) {
+        *mark = 0;
+    }
+
+    size_t got = stream_read(lexer, lexer->buf + lexer->size,
+                             lexer->capacity - lexer->size);
+    if (got == 0) {
+        lexer->drained = true;
+        return false;
+    }
+    lexer->size += got;
+    return true;
+}
+
+/* The last token, the lexer keeps returning it from now on */
+static StreamToken stream_finish(StreamLexer *lexer, StreamToken eof) {
+    eof.ty = Eof;
+    eof.lexeme = NULL;
+    lexer->eof = eof;
+    lexer->finished = true;
+    return eof;
+}
+
+/* Move the line and column of the lexer over the bytes [p, q) */
+static void stream_advance(StreamLexer *lexer, const char *p, const char *q) {
+    size_t newlines = newline_count(p, q - p);
+    if (newlines > 0) {
+        const char *last_newline = q - 1;
+        while (*last_newline != '\n') {
+            last_newline--;
+        }
+        lexer->line += newlines;
+        lexer->column = q - last_newline;
+    } else {
+        lexer->column += q - p;
+    }
+}
+
+StreamToken stream_lexer_next_token(StreamLexer *lexer) {
+    if (lexer->finished) {
+        return lexer->eof;
+    }
+
+    // skip whitespace, NUL bytes count as whitespace as in `Lexer`
+    while (true) {
+        size_t no_mark = STREAM_NO_MARK;
+        if (lexer->pos == lexer->size && !stream_refill(lexer, &no_mark)) {
+            // the virtual null byte at the end is skipped as well
+            StreamToken eof = {
+                .start = lexer->offset + lexer->size + 1,
+                .len = 0,
+                .line = lexer->line,
+                .column = lexer->column + 1,
+            };
+            return stream_finish(lexer, eof);
+        }
+        const char *p = lexer->buf + lexer->pos;
+        const char *end = lexer->buf + lexer->size;
+        const char *q = LEXER_KERNELS->skip_space(p, end);
+        stream_advance(lexer, p, q);
+        lexer->pos = q - lexer->buf;
+        if (q == end) {
+            continue;
+        }
+        if (*q != '\0') {
+            break;
+        }
+        lexer->pos += 1;
+        lexer->column += 1;
+    }
+
+    StreamToken token = {
+        .start = lexer->offset + lexer->pos,
+        .line = lexer->line,
+        .column = lexer->column,
+    };
+    size_t mark = lexer->pos;
+    char first = lexer->buf[lexer->pos];
+    char second = '\0'; /* settles the DFA state, see `lexer_scan_fast` */
+    Utf8State body = UTF8_START; /* of a comment */
+    lexer->pos += 1;
+
+    if (ascii_alnum(first)) {
+        const char *(*run)(const char *, const char *) =
+            ascii_digit(first) ? LEXER_KERNELS->digit_run
+                               : LEXER_KERNELS->alnum_run;
+        while (true) {
+            const char *p = lexer->buf + lexer->pos;
+            const char *end = lexer->buf + lexer->size;
+            const char *q = run(p, end);
+            if (q > p && lexer->offset + lexer->pos == token.start + 1) {
+                second = *p;
+            }
+            lexer->pos = q - lexer->buf;
+            if (q < end || !stream_refill(lexer, &mark)) {
+                break;
+            }
+        }
+    } else if (first == '[') {
+        // comments may span lines, the position is moved along
+        lexer->column += 1;
+        while (true) {
+            const char *p = lexer->buf + lexer->pos;
+            const char *end = lexer->buf + lexer->size;
+            const char *q = utf8_find_bracket(&body, p, end);
+            stream_advance(lexer, p, q < end ? q + 1 : q);
+            lexer->pos = q - lexer->buf;
+            if (q < end) {
+                lexer->pos += 1;
+                second = ']';
+                break;
+            }
+            if (!stream_refill(lexer, &mark)) {
+                // unterminated comment, swallow the rest including the null
+                // byte and report it with the Eof, at the end of the source
+                token.len = lexer->offset + lexer->size + 1 - token.start;
+                token.line = lexer->line;
+                token.column = lexer->column + 1;
+                return stream_finish(lexer, token);
+            }
+        }
+    } else if (first == '-') {
+        if (lexer->pos < lexer->size || stream_refill(lexer, &mark)) {
+            if (lexer->buf[lexer->pos] == '>') {
+                lexer->pos += 1;
+                second = '>';
+            }
+        }
+    }
+
+    token.len = lexer->offset + lexer->pos - token.start;
+    token.lexeme = mark == STREAM_NO_MARK ? NULL : lexer->buf + mark;
+    dfa_next(&lexer->cursor, first);
+    if (token.len > 1) {
+        dfa_next(&lexer->cursor, second);
+    }
+    // lexemes are only dropped when longer than any keyword
+    token.ty = token.lexeme != NULL
+                   ? dfa_token_kind(&lexer->cursor, token.lexeme, token.len)
+                   : lexer->cursor.dfa->kinds[lexer->cursor.state];
+    if (token.ty == Comment && !utf8_done(body)) {
+        token.ty = Invalid;
+    }
+    dfa_reset(&lexer->cursor);
+    if (first != '[') {
+        lexer->column += token.len;
+    }
+    return token;
+}
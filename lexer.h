@@ -2,8 +2,13 @@
 #define MINI_COMPILER_LEXER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
+#include "interner.h"
+#include "line_index.h"
+
 typedef struct Span {
     unsigned start;
     unsigned end;
@@ -29,7 +34,7 @@ typedef enum TokenTy {
     Arrow,        /* -> */
     Less,         /* < */
     Equal,        /* = */
-    Comment,      /* [] */
+    Comment,      /* [], the body is valid UTF-8 */
     Identifier,   /* Identifier */
     Eof,          /* End of file */
     Invalid,      /* Invalid token */
@@ -42,6 +47,14 @@ typedef enum TokenTy {
  */
 TokenTy get_token_type(char *lexeme);
 
+/**
+ * Get token type from a lexeme which is not null terminated
+ * @param lexeme pointer to the first byte of the lexeme
+ * @param len length of the lexeme
+ * @return token type of the lexeme
+ */
+TokenTy get_token_type_n(const char *lexeme, size_t len);
+
 typedef struct Token {
     char *lexeme;
     Span *span;
@@ -52,171 +65,270 @@ Token *eof_token(unsigned start, unsigned end, unsigned line, unsigned col);
 int debug_token(Token *token, char *buf, size_t bufsz);
 void destroy_token(Token *token);
 
+/**
+ * A token borrowed from the source buffer of the lexer, passed by value.
+ * The lexeme is `src[start, start + len)`, nothing is allocated for it.
+ * For `Eof`, `len` covers the trailing unterminated comment (if any).
+ * Lines and columns are not tracked, see `token_view_position`.
+ */
+typedef struct TokenView {
+    unsigned start; /* offset of the lexeme in the source */
+    unsigned len;   /* length of the lexeme */
+    SymbolId symbol; /* interned lexeme of an `Identifier`, or SYMBOL_NONE */
+    TokenTy ty;
+} TokenView;
+
+/**
+ * Line and column a token is reported at: its first byte, for `Eof` the end
+ * of the source (after the trailing unterminated comment, if any)
+ * @param lines line index of the source of the token
+ * @param token
+ * @param line out
+ * @param column out
+ */
+void token_view_position(LineIndex *lines, TokenView token, unsigned *line,
+                         unsigned *column);
+
+#define DFA_N_STATES 18  /* states of the lexer DFA, 0 is the dead state */
+#define DFA_N_CLASSES 18 /* character classes of the lexer DFA */
+
+/**
+ * The transition function is split in two levels: a byte is first mapped to
+ * its character class, the next state is then `table[class][state]`.
+ * State `i` accepts iff bit `i` of `accepts` is set, and the lexeme it
+ * accepted is of kind `kinds[i]`.
+ * The automaton is immutable, a run of it is a `DFACursor`, so any number of
+ * lexers (on any threads) can share it.
+ */
 typedef struct DFA {
-    const int (*table)[9];    /* TODO: better Solution? */
-    const unsigned start;     /* start state */
-    const unsigned n_accepts; /* number of accept states */
-    const unsigned *accepts;  /* accept states */
-    unsigned state;           /* current state */
+    const uint8_t *classes;               /* byte -> character class */
+    const uint8_t (*table)[DFA_N_STATES]; /* class x state -> state */
+    const uint8_t *kinds;                 /* state -> TokenTy */
+    unsigned start;                       /* start state */
+    uint32_t accepts;                     /* bitmask of accept states */
 } DFA;
 
-void dfa_reset(DFA *dfa);
-void dfa_next(DFA *dfa, char c);
-bool dfa_matches(DFA *dfa, const char *s);
+extern const DFA LEXER_DFA;
+
+/* The current state of a run of a DFA */
+typedef struct DFACursor {
+    const DFA *dfa;
+    unsigned state;
+} DFACursor;
+
+/**
+ * Start a run of a DFA
+ * @param dfa
+ * @return a cursor in the start state
+ */
+DFACursor dfa_cursor(const DFA *dfa);
+void dfa_reset(DFACursor *cursor);
+void dfa_next(DFACursor *cursor, char c);
+bool dfa_matches(const DFA *dfa, const char *s);
+
+/**
+ * Kind of the lexeme accepted by the DFA, the cursor must be in the state it
+ * reached after consuming the lexeme
+ * @param cursor
+ * @param lexeme pointer to the first byte of the lexeme
+ * @param len length of the lexeme
+ * @return token type of the lexeme, `Invalid` if the state is not accepting
+ */
+TokenTy dfa_token_kind(const DFACursor *cursor, const char *lexeme,
+                       size_t len);
+
+/**
+ * Receives the range `src[start, start + len)` of a comment, brackets
+ * included
+ */
+typedef void (*LexerCommentFn)(void *ctx, unsigned start, unsigned len);
 
 typedef struct Lexer {
-    DFA *dfa;
+    DFACursor cursor;
     unsigned start; /* start position of the current lexeme */
     unsigned end;   /* end position of the current lexeme */
     const char *src;
     unsigned len; /* len of the source code, null byte EXCLUDED */
-    unsigned line;
-    unsigned column;
+    Interner *interner; /* names of the identifiers, not interned if NULL */
+    LineIndex *lines;   /* positions of `lexer_next_token`, built on demand */
+    bool skip_comments; /* no `Comment` token is returned */
+    LexerCommentFn on_comment; /* called for every comment, may be NULL */
+    void *comment_ctx;
 } Lexer;
 
+/**
+ * Kernels used by the fast paths of the lexer. `LEXER_SIMD_OFF` steps the
+ * DFA byte by byte, the others skip whitespace, identifier/number runs and
+ * comment bodies in blocks. The widest supported kernels are the default.
+ */
+typedef enum LexerSimd {
+    LEXER_SIMD_OFF,
+    LEXER_SIMD_SCALAR,
+    LEXER_SIMD_SSE2,
+    LEXER_SIMD_AVX2,
+} LexerSimd;
+
+/**
+ * Select the kernels of the lexer fast paths (process wide)
+ * @param simd the requested kernels
+ * @return the kernels in effect, lowered if the cpu lacks support
+ */
+LexerSimd lexer_set_simd(LexerSimd simd);
+LexerSimd lexer_get_simd();
+
 Lexer *lexer_new(const char *src);
+
+/**
+ * Create a lexer over a source which is not null terminated
+ * @param src pointer to the first byte of the source
+ * @param len length of the source, null bytes in it are whitespace
+ * @return the lexer
+ */
+Lexer *lexer_new_n(const char *src, unsigned len);
+
+/**
+ * Skip comments inside the lexer, the next and the batch interfaces never
+ * return a `Comment` token and nothing is allocated for comments. An
+ * unterminated comment still ends the source with an `Eof` covering it.
+ * A comment whose body is not valid UTF-8 is an `Invalid` token and is
+ * never skipped.
+ * @param lexer
+ * @param skip
+ */
+void lexer_skip_comments(Lexer *lexer, bool skip);
+
+/**
+ * Report the range of every terminated, valid UTF-8 comment the lexer
+ * scans, whether it is skipped or returned as a token
+ * @param lexer
+ * @param on_comment the callback, NULL to stop reporting
+ * @param ctx passed to the callback
+ */
+void lexer_on_comment(Lexer *lexer, LexerCommentFn on_comment, void *ctx);
 Token *lexer_next_token(Lexer *lexer);
+TokenView lexer_next_view(Lexer *lexer);
+const char *lexer_lexeme(const Lexer *lexer, TokenView token);
+int debug_token_view(const Lexer *lexer, TokenView token, char *buf,
+                     size_t bufsz);
 void destroy_lexer(Lexer *lexer);
 
-static const unsigned ACCEPTS[5] = {2, 4, 5, 7, 8};
-static const unsigned N_ACCEPTS = sizeof(ACCEPTS) / sizeof(ACCEPTS[0]);
-
-static const int TABLE[256][9] = {
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 8, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 8, 0, 0, 0, 0, 6, 0, 0}, {0, 8, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 8, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 3, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 8, 2, 0, 0, 5, 6, 0, 0}, {0, 2, 2, 0, 0, 5, 6, 0, 0},
-    {0, 2, 2, 0, 0, 5, 6, 0, 0}, {0, 2, 2, 0, 0, 5, 6, 0, 0},
-    {0, 2, 2, 0, 0, 5, 6, 0, 0}, {0, 2, 2, 0, 0, 5, 6, 0, 0},
-    {0, 2, 2, 0, 0, 5, 6, 0, 0}, {0, 2, 2, 0, 0, 5, 6, 0, 0},
-    {0, 2, 2, 0, 0, 5, 6, 0, 0}, {0, 2, 2, 0, 0, 5, 6, 0, 0},
-    {0, 8, 0, 0, 0, 0, 6, 0, 0}, {0, 8, 0, 0, 0, 0, 6, 0, 0},
-    {0, 8, 0, 0, 0, 0, 6, 0, 0}, {0, 8, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 4, 0, 0, 6, 0, 0}, {0, 8, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 6, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 7, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 5, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 5, 0, 0, 0, 5, 6, 0, 0},
-    {0, 5, 0, 0, 0, 5, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0},
-    {0, 1, 0, 0, 0, 0, 6, 0, 0}, {0, 1, 0, 0, 0, 0, 6, 0, 0}};
-
-static struct DFA LEXER_DFA = {
-    .n_accepts = N_ACCEPTS,
-    .accepts = ACCEPTS,
-    .table = TABLE,
-    .start = 1,
-    .state = 1,
-};
+/**
+ * Tokens of a whole source as parallel arrays (struct-of-arrays),
+ * the i-th token is (ty[i], start[i], len[i], symbol[i]).
+ * A buffer filled by `lexer_tokenize_all` always ends with an `Eof` token.
+ */
+typedef struct TokenBuffer {
+    size_t size;
+    size_t capacity;
+    uint8_t *ty; /* TokenTy */
+    uint32_t *start;
+    uint32_t *len;
+    SymbolId *symbol;
+    Interner *interner; /* interner the symbols come from, may be NULL */
+    /* comment handling of the lexer, `lexer_relex` lexes the same way */
+    bool skip_comments;
+    LexerCommentFn on_comment;
+    void *comment_ctx;
+} TokenBuffer;
+
+TokenBuffer *token_buffer_new(size_t capacity);
+void token_buffer_reserve(TokenBuffer *tokens, size_t capacity);
+void token_buffer_push(TokenBuffer *tokens, TokenView token);
+TokenView token_buffer_get(const TokenBuffer *tokens, size_t i);
+void destroy_token_buffer(TokenBuffer *tokens);
+TokenBuffer *lexer_tokenize_all(Lexer *lexer);
+
+/**
+ * Tokenize a source with several threads, the result is the same as the one
+ * of `lexer_tokenize_all` over the whole source. The source is cut in chunks
+ * of about `chunk_size` bytes at whitespace outside comments.
+ * @param src pointer to the first byte of the source
+ * @param len length of the source
+ * @param n_threads number of threads, 0 for one per online cpu
+ * @param chunk_size bytes per chunk, 0 for the default (1 MB)
+ * @param interner interner of the identifiers, NULL to not intern them
+ * @return tokens of the whole source
+ */
+TokenBuffer *lexer_tokenize_parallel(const char *src, unsigned len,
+                                     unsigned n_threads, unsigned chunk_size,
+                                     Interner *interner);
+
+/**
+ * An edit of a source: `deleted` bytes at `offset` were replaced by
+ * `inserted` bytes
+ */
+typedef struct LexEdit {
+    unsigned offset;
+    unsigned deleted;
+    unsigned inserted;
+} LexEdit;
+
+/**
+ * Bring the tokens of a source up to date after an edit. Only the tokens
+ * around the edit are lexed again, the ones after are shifted.
+ * @param tokens tokens of the source before the edit, as produced by
+ * `lexer_tokenize_all`, updated in place. New identifiers are added to
+ * `tokens->interner` (if any). Comments are skipped and reported as the
+ * buffer was lexed, the ones lexed again are reported again.
+ * @param src the source after the edit, the inserted text is
+ * `src[offset, offset + inserted)`
+ * @param len length of the source after the edit
+ * @param edit
+ * @return number of tokens which were lexed again
+ */
+size_t lexer_relex(TokenBuffer *tokens, const char *src, unsigned len,
+                   LexEdit edit);
+
+/**
+ * A token of the streaming lexer. Offsets are 64-bit, inputs may be larger
+ * than 4 GB. Unlike `TokenView` it carries its line and column, the source
+ * is gone once it is lexed. `lexeme` points into the buffer of the lexer and
+ * is valid until the next call, it is NULL for `Eof` and for tokens longer
+ * than the buffer.
+ */
+typedef struct StreamToken {
+    uint64_t start; /* offset of the lexeme in the stream */
+    uint64_t len;   /* length of the lexeme */
+    uint64_t line;
+    uint64_t column;
+    const char *lexeme;
+    TokenTy ty;
+} StreamToken;
+
+/**
+ * Lexer reading its source from a file descriptor or a `FILE *` through a
+ * fixed size buffer, memory use does not depend on the size of the input.
+ * Produces the same tokens as `Lexer` over the whole source.
+ */
+typedef struct StreamLexer {
+    DFACursor cursor;
+    int fd;     /* source if `file` is NULL */
+    FILE *file; /* source */
+    char *buf;
+    size_t capacity;
+    size_t size;     /* bytes in buf */
+    size_t pos;      /* next byte to scan in buf */
+    uint64_t offset; /* offset of buf[0] in the stream */
+    uint64_t line;
+    uint64_t column;
+    bool drained;  /* nothing left to read */
+    bool finished; /* `eof` is returned from now on */
+    int error;     /* errno of a failed read, which ends the stream */
+    StreamToken eof;
+} StreamLexer;
+
+#define STREAM_LEXER_DEFAULT_CAPACITY (64 * 1024)
+#define STREAM_LEXER_MIN_CAPACITY 8 /* longer than any keyword */
+
+/**
+ * Create a streaming lexer, the source is not closed by `destroy_stream_lexer`
+ * @param fd source file descriptor
+ * @param capacity size of the buffer, 0 for the default
+ * @return the lexer
+ */
+StreamLexer *stream_lexer_new_fd(int fd, size_t capacity);
+StreamLexer *stream_lexer_new_file(FILE *file, size_t capacity);
+StreamToken stream_lexer_next_token(StreamLexer *lexer);
+void destroy_stream_lexer(StreamLexer *lexer);
 
 #endif  // MINI_COMPILER_LEXER_H
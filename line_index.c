@@ -0,0 +1,125 @@
+#include "line_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t newline_count_scalar(const char *p, size_t len) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        count += p[i] == '\n';
+    }
+    return count;
+}
+
+static size_t (*NEWLINE_COUNT)(const char *p, size_t len) =
+    newline_count_scalar;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/*
+ * The compare results of a block are subtracted from per-lane byte counters,
+ * which are summed before any of them can overflow (255 blocks).
+ */
+
+static size_t newline_count_sse2(const char *p, size_t len) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    while (len >= 16) {
+        size_t blocks = len / 16 < 255 ? len / 16 : 255;
+        __m128i acc = _mm_setzero_si128();
+        for (size_t i = 0; i < blocks; i++, p += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, newline));
+        }
+        __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (uint32_t)_mm_cvtsi128_si32(sum) +
+                 (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+        len -= blocks * 16;
+    }
+    return count + newline_count_scalar(p, len);
+}
+
+__attribute__((target("avx2"))) static size_t newline_count_avx2(
+    const char *p, size_t len) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    while (len >= 32) {
+        size_t blocks = len / 32 < 255 ? len / 32 : 255;
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t i = 0; i < blocks; i++, p += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, newline));
+        }
+        __m256i wide = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(wide),
+                                    _mm256_extracti128_si256(wide, 1));
+        count += (uint32_t)_mm_cvtsi128_si32(sum) +
+                 (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+        len -= blocks * 32;
+    }
+    return count + newline_count_sse2(p, len);
+}
+
+__attribute__((constructor)) static void newline_count_detect() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        NEWLINE_COUNT = newline_count_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        NEWLINE_COUNT = newline_count_sse2;
+    }
+}
+#endif  // __x86_64__ || __i386__
+
+size_t newline_count(const char *p, size_t len) {
+    return NEWLINE_COUNT(p, len);
+}
+
+LineIndex *line_index_new(const char *src, unsigned len) {
+    LineIndex *index = (LineIndex *)malloc(sizeof(LineIndex));
+    index->src = src;
+    index->len = len;
+    index->starts = NULL;
+    index->n_lines = 0;
+    return index;
+}
+
+/* Count the lines first so that the offsets are stored without regrowth */
+static void line_index_build(LineIndex *index) {
+    const char *src = index->src;
+    size_t n_lines = newline_count(src, index->len) + 1;
+    index->starts = (uint32_t *)malloc(sizeof(uint32_t) * n_lines);
+    index->starts[0] = 0;
+    const char *p = src;
+    const char *end = src + index->len;
+    for (size_t i = 1; i < n_lines; i++) {
+        p = (const char *)memchr(p, '\n', end - p) + 1;
+        index->starts[i] = p - src;
+    }
+    index->n_lines = n_lines;
+}
+
+void line_index_lookup(LineIndex *index, unsigned offset, unsigned *line,
+                       unsigned *column) {
+    if (index->n_lines == 0) {
+        line_index_build(index);
+    }
+    // the last line starting at or before the offset
+    size_t lo = 1;
+    size_t hi = index->n_lines;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->starts[mid] <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *line = lo;
+    *column = offset - index->starts[lo - 1] + 1;
+}
+
+void destroy_line_index(LineIndex *index) {
+    free(index->starts);
+    free(index);
+}
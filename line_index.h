@@ -0,0 +1,48 @@
+#ifndef MINI_COMPILER_LINE_INDEX_H
+#define MINI_COMPILER_LINE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Maps byte offsets of a source to lines and columns. Tokens only carry
+ * offsets, the source is scanned for newlines the first time a position is
+ * asked for, positions are then found by binary search.
+ */
+typedef struct LineIndex {
+    const char *src;
+    unsigned len;
+    uint32_t *starts; /* offset of the first byte of every line */
+    size_t n_lines;   /* 0 until the index is built */
+} LineIndex;
+
+/**
+ * Create the index of a source, nothing is scanned yet
+ * @param src pointer to the first byte of the source, borrowed
+ * @param len length of the source
+ * @return the index
+ */
+LineIndex *line_index_new(const char *src, unsigned len);
+
+/**
+ * Line and column of an offset, both starting from 1. Every byte (tabs
+ * included) is one column, offsets past the end of the source are on the
+ * last line.
+ * @param index
+ * @param offset
+ * @param line out
+ * @param column out
+ */
+void line_index_lookup(LineIndex *index, unsigned offset, unsigned *line,
+                       unsigned *column);
+
+/**
+ * Number of '\n' in a buffer, counted in simd blocks when the cpu allows
+ * @param p
+ * @param len
+ * @return number of newlines
+ */
+size_t newline_count(const char *p, size_t len);
+void destroy_line_index(LineIndex *index);
+
+#endif  // MINI_COMPILER_LINE_INDEX_H
@@ -1,19 +1,32 @@
 #include "parse_tree.h"
 
+#include "arena.h"
+
+static const CC_DequeConf UNIT_DEQUE_CONF = {
+    .capacity = 8, /* the default of cc_deque_conf_init */
+    .mem_alloc = unit_malloc,
+    .mem_calloc = unit_calloc,
+    .mem_free = unit_free,
+};
+
+enum cc_stat cc_deque_new_unit(CC_Deque **deque) {
+    return cc_deque_new_conf(&UNIT_DEQUE_CONF, deque);
+}
+
 ParseTree *parse_tree_init(ParseTreeNode *node) {
-    ParseTree *tree = malloc(sizeof(ParseTree));
+    ParseTree *tree = unit_malloc(sizeof(ParseTree));
     tree->root = node;
     return tree;
 }
 
 SLRSymbol *slr_symbol_init_nt(NonTerminal nt) {
-    SLRSymbol *sym = malloc(sizeof(SLRSymbol));
+    SLRSymbol *sym = unit_malloc(sizeof(SLRSymbol));
     sym->nt = nt;
     return sym;
 }
 
 ParseTreeNode *parse_tree_node_init(SLRSymbol *sym, NodeTy ty) {
-    ParseTreeNode *node = malloc(sizeof(ParseTreeNode));
+    ParseTreeNode *node = unit_malloc(sizeof(ParseTreeNode));
     node->SLRSymbol = sym;
     node->ty = ty;
     node->children = NULL;
@@ -22,14 +35,14 @@ ParseTreeNode *parse_tree_node_init(SLRSymbol *sym, NodeTy ty) {
 
 void parse_tree_node_add_first(ParseTreeNode *node, ParseTreeNode *child) {
     if (node->children == NULL) {
-        cc_deque_new(&node->children);
+        cc_deque_new_unit(&node->children);
     }
     cc_deque_add_first(node->children, child);
 }
 
 void parse_tree_node_add_last(ParseTreeNode *node, ParseTreeNode *child) {
     if (node->children == NULL) {
-        cc_deque_new(&node->children);
+        cc_deque_new_unit(&node->children);
     }
     cc_deque_add_last(node->children, child);
 }
@@ -45,32 +58,41 @@ ParseTreeNode *parse_tree_node_remove_last(ParseTreeNode *node) {
 }
 
 void destroy_parse_tree_node(ParseTreeNode *node) {
-    if (node->SLRSymbol != NULL) {
-        switch (node->ty) {
-            case NODE_TERMINAL:
-                destroy_token(node->SLRSymbol->token);
-                free(node->SLRSymbol);
-                break;
-            case NODE_NON_TERMINAL:
-                free(node->SLRSymbol);
-                break;
-        }
+    if (unit_arena() != NULL) {
+        // the whole tree goes away with the arena
+        return;
     }
+    // nodes left to free, a deep tree costs no stack frame
+    size_t n_pending = 0, capacity = 64;
+    ParseTreeNode **pending = malloc(sizeof(ParseTreeNode *) * capacity);
+    pending[n_pending++] = node;
+    while (n_pending > 0) {
+        node = pending[--n_pending];
+        if (node->SLRSymbol != NULL) {
+            free(node->SLRSymbol);
+        }
 
-    if (node->children != NULL) {
-        for (size_t i = 0; i < cc_deque_size(node->children); i++) {
-            ParseTreeNode *child;
-            cc_deque_get_at(node->children, i, (void *)&child);
-            destroy_parse_tree_node(child);
+        if (node->children != NULL) {
+            size_t n_children = cc_deque_size(node->children);
+            if (n_pending + n_children > capacity) {
+                capacity = (n_pending + n_children) * 2;
+                pending =
+                    realloc(pending, sizeof(ParseTreeNode *) * capacity);
+            }
+            for (size_t i = 0; i < n_children; i++) {
+                cc_deque_get_at(node->children, i,
+                                (void *)&pending[n_pending++]);
+            }
+            cc_deque_destroy(node->children);
         }
-        cc_deque_destroy(node->children);
+        free(node);
     }
-    free(node);
+    free(pending);
 }
 
 void destroy_parse_tree(ParseTree *tree) {
     destroy_parse_tree_node(tree->root);
-    free(tree);
+    unit_free(tree);
 }
 
 /*
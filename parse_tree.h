@@ -235,11 +235,19 @@ const void *const *cc_deque_get_buffer(CC_Deque const *const deque);
 
 #include "lexer.h"
 
+/**
+ * New deque whose struct and buffers come from the arena of the compilation
+ * unit when one is entered, see `arena_enter`
+ * @param deque out
+ * @return CC_OK, or CC_ERR_ALLOC
+ */
+enum cc_stat cc_deque_new_unit(CC_Deque **deque);
+
 typedef char NonTerminal;
 
 typedef union {
     NonTerminal nt;
-    Token *token;  // Take the **ownership** of the token
+    TokenView token;  // Borrows the lexeme from the source buffer
 } SLRSymbol;
 
 SLRSymbol *slr_symbol_init_nt(NonTerminal nt);
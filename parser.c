@@ -2,6 +2,9 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
 
 #ifdef LOG
 #include "log.h"
@@ -68,114 +71,304 @@ Grammar *grammar_new() {
 
 void destroy_grammar(Grammar *g) { free(g); }
 
-SLRItem *slr_item_token(Token *tok, SLRSymbolTy ty, unsigned value) {
-    SLRItem *item = malloc(sizeof(SLRItem));
+/* Push an entry, the stack grows by doubling */
+static void slr_parser_push(SLRParser *parser, SLRItem item) {
+    if (parser->stack_size == parser->stack_capacity) {
+        // no realloc under an arena, copy to a larger block instead
+        SLRItem *stack =
+            unit_malloc(sizeof(SLRItem) * parser->stack_capacity * 2);
+        memcpy(stack, parser->stack, sizeof(SLRItem) * parser->stack_size);
+        unit_free(parser->stack);
+        parser->stack = stack;
+        parser->stack_capacity *= 2;
+    }
+    parser->stack[parser->stack_size++] = item;
+}
 
-    SLRSymbol *sym = malloc(sizeof(SLRSymbol));
-    sym->token = tok;
+static void slr_parser_push_token(SLRParser *parser, TokenView tok,
+                                  SLRSymbolTy ty, unsigned value) {
+    slr_parser_push(parser, (SLRItem){.symbol = {.token = tok},
+                                      .ty = ty,
+                                      .value = value});
+}
 
-    item->symbol = sym;
-    item->ty = ty;
-    item->value = value;
-    return item;
+static void slr_parser_push_nt(SLRParser *parser, NonTerminal nt,
+                               unsigned value) {
+    slr_parser_push(parser, (SLRItem){.symbol = {.nt = nt},
+                                      .ty = SLR_SYMBOL_NON_TERMINAL,
+                                      .value = value});
 }
 
-SLRItem *slr_item_nt(NonTerminal nt, SLRSymbolTy ty, unsigned value) {
-    SLRItem *item = malloc(sizeof(SLRItem));
+/* Rebuilds the text of the stack step by step from a trace */
+typedef struct SLRTraceReplay {
+    StringBuilder *stack;  // text of the stack
+    size_t *offsets;       // where the text of each entry starts
+    size_t depth;
+    size_t capacity;
+} SLRTraceReplay;
+
+static void slr_trace_replay_push(SLRTraceReplay *replay,
+                                  const SLRItem *item) {
+    if (replay->depth == replay->capacity) {
+        replay->capacity *= 2;
+        replay->offsets =
+            realloc(replay->offsets, sizeof(size_t) * replay->capacity);
+    }
+    replay->offsets[replay->depth++] = replay->stack->length;
+    if (replay->depth > 1) {
+        string_builder_append(replay->stack, ", ");
+    }
+    stringify_slr_item(item, replay->stack);
+}
 
-    SLRSymbol *sym = malloc(sizeof(SLRSymbol));
-    sym->nt = nt;
+/* The replay starts from the stack of a new parser */
+static void slr_trace_replay_init(SLRTraceReplay *replay) {
+    replay->stack = string_builder_init();
+    replay->stack->str[0] = '\0';
+    replay->capacity = SLR_STACK_INITIAL_CAPACITY;
+    replay->offsets = malloc(sizeof(size_t) * replay->capacity);
+    replay->depth = 0;
+    SLRItem bottom = {.ty = SLR_SYMBOL_VOID, .value = 0};
+    slr_trace_replay_push(replay, &bottom);
+}
 
-    item->symbol = sym;
-    item->ty = ty;
-    item->value = value;
-    return item;
+/* Only the popped and pushed entries are rendered, not the whole stack */
+static void slr_trace_replay_step(SLRTraceReplay *replay,
+                                  const SLRTraceStep *step) {
+    if (step->popped > 0) {
+        replay->depth -= step->popped;
+        replay->stack->length = replay->offsets[replay->depth];
+        replay->stack->str[replay->stack->length] = '\0';
+    }
+    SLRItem item = {.value = step->state};
+    if (step->op == SLR_REDUCE && step->value != 0) {
+        item.ty = SLR_SYMBOL_NON_TERMINAL;
+        item.symbol.nt = (NonTerminal)step->symbol;
+    } else {
+        item.ty = SLR_SYMBOL_TOKEN;
+        item.symbol.token.ty = (TokenTy)step->symbol;
+    }
+    slr_trace_replay_push(replay, &item);
+}
+
+static void destroy_slr_trace_replay(SLRTraceReplay *replay) {
+    free(string_builder_build(replay->stack));
+    free(replay->offsets);
+}
+
+/* Writes a row per step as the parser runs, through a buffer of its own */
+struct SLRTraceStream {
+    FILE *fp;
+    unsigned step_width;   // 0: adaptive
+    unsigned stack_width;
+    bool adaptive;  // the stack column widens to the widest row so far
+    size_t n_rows;
+    SLRTraceReplay replay;
+    char *buf;
+    size_t len;
+    size_t capacity;
+};
+
+static void slr_trace_stream_flush(SLRTraceStream *stream) {
+    fwrite(stream->buf, 1, stream->len, stream->fp);
+    stream->len = 0;
+}
+
+static void slr_trace_stream_write(SLRTraceStream *stream, const char *s,
+                                   size_t n) {
+    if (stream->len + n > stream->capacity) {
+        slr_trace_stream_flush(stream);
+        if (n > stream->capacity) {
+            fwrite(s, 1, n, stream->fp);
+            return;
+        }
+    }
+    memcpy(stream->buf + stream->len, s, n);
+    stream->len += n;
+}
+
+static void slr_trace_stream_pad(SLRTraceStream *stream, size_t n) {
+    static const char SPACES[] = "                                ";
+    for (; n > 0; n -= n < 32 ? n : 32) {
+        slr_trace_stream_write(stream, SPACES, n < 32 ? n : 32);
+    }
+}
+
+/* A row as `slr_parser_display_trace` prints it, the widths aside */
+static void slr_trace_stream_row(SLRTraceStream *stream, const char *op) {
+    char step[32];
+    size_t n = snprintf(step, sizeof(step), "Step %zu", stream->n_rows++);
+    size_t step_width = stream->step_width + 5;  // "Step "
+    slr_trace_stream_write(stream, step, n);
+    slr_trace_stream_pad(stream, n < step_width ? step_width - n : 0);
+    slr_trace_stream_write(stream, ":<", 2);
+    const StringBuilder *text = stream->replay.stack;
+    if (stream->adaptive && text->length > stream->stack_width) {
+        stream->stack_width = text->length;
+    }
+    slr_trace_stream_write(stream, text->str, text->length);
+    slr_trace_stream_pad(stream, text->length < stream->stack_width
+                                     ? stream->stack_width - text->length
+                                     : 0);
+    slr_trace_stream_write(stream, "\t", 1);
+    slr_trace_stream_write(stream, op, strlen(op));
+    slr_trace_stream_write(stream, "\n", 1);
+}
+
+static void slr_trace_stream_step(SLRTraceStream *stream,
+                                  const SLRTraceStep *step,
+                                  Grammar *grammar) {
+    slr_trace_replay_step(&stream->replay, step);
+    char *op = stringify_slr_trace_step(step, grammar);
+    slr_trace_stream_row(stream, op);
+    free(op);
+    if (step->op == SLR_EMPTY || (step->op == SLR_REDUCE && step->value == 0)) {
+        // the parse is over
+        slr_trace_stream_flush(stream);
+    }
+}
+
+static void destroy_slr_trace_stream(SLRTraceStream *stream) {
+    slr_trace_stream_flush(stream);
+    destroy_slr_trace_replay(&stream->replay);
+    free(stream->buf);
+    free(stream);
+}
+
+/**
+ * Record a step, the entry on top of the stack is the one it pushed
+ * @param parser
+ * @param op SLR_EMPTY for a syntax error
+ * @param value value of the op
+ * @param popped entries popped before the push
+ */
+static void slr_parser_record(SLRParser *parser, SLRopTy op, unsigned value,
+                              size_t popped) {
+    if (!parser->tracing && parser->stream == NULL) {
+        return;
+    }
+    const SLRItem *top = &parser->stack[parser->stack_size - 1];
+    SLRTraceStep step = {
+        .op = op,
+        .symbol = top->ty == SLR_SYMBOL_NON_TERMINAL
+                      ? (uint8_t)top->symbol.nt
+                      : (uint8_t)top->symbol.token.ty,
+        .popped = popped,
+        .state = top->value,
+        .value = value,
+    };
+    if (parser->stream != NULL) {
+        slr_trace_stream_step(parser->stream, &step, parser->grammar);
+        return;
+    }
+    SLRTrace *trace = parser->trace;
+    if (trace->size == trace->capacity) {
+        trace->capacity *= 2;
+        trace->steps =
+            realloc(trace->steps, sizeof(SLRTraceStep) * trace->capacity);
+    }
+    trace->steps[trace->size++] = step;
 }
 
 SLRParser *slr_parser_init(Grammar *grammar, const SLRTable *table) {
-    SLRParser *parser = malloc(sizeof(SLRParser));
+    SLRParser *parser = unit_malloc(sizeof(SLRParser));
 
     parser->grammar = grammar;
     parser->table = table;
-    cc_deque_new(&parser->stack);
-    SLRItem *item = slr_item_token(NULL, SLR_SYMBOL_VOID, 0);
-    cc_deque_add(parser->stack, item);
+    parser->stack = unit_malloc(sizeof(SLRItem) * SLR_STACK_INITIAL_CAPACITY);
+    parser->stack_size = 0;
+    parser->stack_capacity = SLR_STACK_INITIAL_CAPACITY;
+    slr_parser_push_token(parser, (TokenView){0}, SLR_SYMBOL_VOID, 0);
     parser->trace = slr_trace_init();
-    cc_deque_add_last(parser->trace->stack_trace,
-                      (void *)stringify_slr_stack(parser));
-    cc_deque_add_last(parser->trace->op_trace,
-                      (void *)calloc(1, sizeof(char)));  // empty string
+    parser->tracing = true;
+    parser->stream = NULL;
     parser->parse_tree = parse_tree_node_init(NULL, NODE_NON_TERMINAL);
     return parser;
 }
 
-void deep_destroy_slr_item(SLRItem *item) {
-    if (item->ty == SLR_SYMBOL_TOKEN) {
-        destroy_token(item->symbol->token);
-    }
-    free(item->symbol);
-    free(item);
-}
-
-void shallow_destroy_slr_item(SLRItem *item) { free(item); }
-
-void destroy_slr_item_cb(void *item) { deep_destroy_slr_item((SLRItem *)item); }
-
 void destroy_slr_parser(SLRParser *parser) {
+    // the trace is on the heap even under an arena
+    destroy_slr_trace(parser->trace);
+    if (parser->stream != NULL) {
+        destroy_slr_trace_stream(parser->stream);
+    }
+    if (unit_arena() != NULL) {
+        return;
+    }
     if (parser->parse_tree != NULL) {
         destroy_parse_tree_node(parser->parse_tree);
     }
-    cc_deque_destroy_cb(parser->stack, destroy_slr_item_cb);
-    destroy_slr_trace(parser->trace);
+    unit_free(parser->stack);
     free(parser);
 }
 
-ParserState slr_parser_step(SLRParser *parser, Token *tok) {
-    char *buf;
-    log_debug("Step(%s)", tok->lexeme);
-    SLRItem *last = NULL;
-    cc_deque_get_last(parser->stack, (void *)&last);
-    SLRop next = shift_reduce_table_get(parser->table->shift_reduce_table,
-                                        last->value, tok->ty);
-    if (next.ty == SLR_SHIFT) {
-        log_debug("(Shift, %d)", next.value);
-        SLRItem *item = slr_item_token(tok, SLR_SYMBOL_TOKEN, next.value);
-        cc_deque_add_last(parser->stack, (void *)item);
-        // Display the SLR Stack
-        cc_deque_add_last(parser->trace->stack_trace,
-                          (void *)stringify_slr_stack(parser));
-        cc_deque_add_last(parser->trace->op_trace,
-                          (void *)stringify_slr_op(&next, parser->grammar));
-    } else if (next.ty == SLR_REDUCE) {
-        log_debug("(Reduce, %d)", next.value);
-        if (next.value == 0) {
-            log_debug("Accept!");
-            SLRItem *item = slr_item_token(tok, SLR_SYMBOL_TOKEN, 0);
-            cc_deque_add_last(parser->stack, (void *)item);
-            cc_deque_add_last(parser->trace->stack_trace,
-                              (void *)stringify_slr_stack(parser));
-            cc_deque_add_last(parser->trace->op_trace,
-                              (void *)to_string("accept"));
-            return PARSER_ACCEPT;
-        }
-        Production prod = parser->grammar->prods[next.value];
-        // Consume all the rhs item and create a new parse tree node
-        ParseTreeNode *node = parse_tree_node_init(
-            slr_symbol_init_nt(prod.lhs.value.nt), NODE_NON_TERMINAL);
-        for (int i = (int)(prod.n_rhs - 1); i >= 0; i--) {
-            if (cc_deque_remove_last(parser->stack, (void *)&last) == CC_OK) {
+void slr_parser_trace(SLRParser *parser, bool enabled) {
+    parser->tracing = enabled;
+    if (!enabled) {
+        parser->trace->size = 0;
+    }
+}
+
+void slr_parser_stream_trace(SLRParser *parser, FILE *fp, unsigned step_width,
+                             unsigned stack_width) {
+    slr_parser_trace(parser, false);
+    SLRTraceStream *stream = malloc(sizeof(SLRTraceStream));
+    stream->fp = fp;
+    stream->step_width = step_width;
+    stream->stack_width = stack_width;
+    stream->adaptive = stack_width == 0;
+    stream->n_rows = 0;
+    slr_trace_replay_init(&stream->replay);
+    stream->capacity = SLR_TRACE_STREAM_BUFFER_SIZE;
+    stream->buf = malloc(stream->capacity);
+    stream->len = 0;
+    // the stack of a new parser, with no operation
+    slr_trace_stream_row(stream, "");
+    parser->stream = stream;
+}
+
+ParserState slr_parser_step(SLRParser *parser, TokenView tok) {
+    log_debug("Step(%d)", tok.ty);
+    // a reduce is followed by a goto, then the same token is looked up
+    // again, a chain of reductions costs no stack frame
+    for (;;) {
+        SLRItem *last = &parser->stack[parser->stack_size - 1];
+        SLRop next = shift_reduce_table_get(parser->table, last->value, tok.ty);
+        if (next.ty == SLR_SHIFT) {
+            log_debug("(Shift, %d)", next.value);
+            slr_parser_push_token(parser, tok, SLR_SYMBOL_TOKEN, next.value);
+            slr_parser_record(parser, SLR_SHIFT, next.value, 0);
+            return PARSER_IDLE;
+        } else if (next.ty == SLR_REDUCE) {
+            log_debug("(Reduce, %d)", next.value);
+            if (next.value == 0) {
+                log_debug("Accept!");
+                slr_parser_push_token(parser, tok, SLR_SYMBOL_TOKEN, 0);
+                slr_parser_record(parser, SLR_REDUCE, 0, 0);
+                return PARSER_ACCEPT;
+            }
+            Production prod = parser->grammar->prods[next.value];
+            // Do not have enough item to reduce a production rule, the bottom
+            // entry is never popped
+            if (parser->stack_size <= prod.n_rhs) {
+                return PARSER_REJECT;
+            }
+            // Consume all the rhs item and create a new parse tree node
+            ParseTreeNode *node = parse_tree_node_init(
+                slr_symbol_init_nt(prod.lhs.value.nt), NODE_NON_TERMINAL);
+            for (int i = (int)(prod.n_rhs - 1); i >= 0; i--) {
+                last = &parser->stack[--parser->stack_size];
                 // check if production rule is matched
                 // Terminal
                 if (last->ty == SLR_SYMBOL_TOKEN) {
                     if (prod.rhs[i].ty == TERM_TERMINAL &&
-                        prod.rhs[i].value.t == last->symbol->token->ty) {
-                        // TODO: Remove this line if the ownership is
-                        // TODO: transferred to the parse tree
+                        prod.rhs[i].value.t == last->symbol.token.ty) {
+                        // the tree keeps its own copy of the token
+                        SLRSymbol *sym = unit_malloc(sizeof(SLRSymbol));
+                        *sym = last->symbol;
                         parse_tree_node_add_first(
-                            node,
-                            parse_tree_node_init(last->symbol, NODE_TERMINAL));
+                            node, parse_tree_node_init(sym, NODE_TERMINAL));
                     } else {
-                        deep_destroy_slr_item(last);
                         return PARSER_REJECT;
                     }
                 }
@@ -183,55 +376,68 @@ ParserState slr_parser_step(SLRParser *parser, Token *tok) {
                 // Non-terminal
                 if (last->ty == SLR_SYMBOL_NON_TERMINAL) {
                     if (prod.rhs[i].ty == TERM_NON_TERMINAL &&
-                        prod.rhs[i].value.nt == last->symbol->nt) {
+                        prod.rhs[i].value.nt == last->symbol.nt) {
                         ParseTreeNode *nt_node =
                             parse_tree_node_remove_last(parser->parse_tree);
                         parse_tree_node_add_first(node, nt_node);
-                        free(last->symbol);  // ugly patch to fix mem leak
                     } else {
-                        deep_destroy_slr_item(last);
                         return PARSER_REJECT;
                     }
                 }
-                // shallow destroy since the token will be taken by parse tree
-                shallow_destroy_slr_item(last);
-            } else {
-                // Do not have enough item to reduce a production rule
-                return PARSER_REJECT;
             }
+            // Node construction is done, push to the tree
+            parse_tree_node_add_last(parser->parse_tree, node);
+            // Push the lhs item to the stack
+            last = &parser->stack[parser->stack_size - 1];
+            SLRop op =
+                goto_table_get(parser->table, last->value, prod.lhs.value.nt);
+            log_debug("(GOTO, %d)", op.value);
+            slr_parser_push_nt(parser, prod.lhs.value.nt, op.value);
+            slr_parser_record(parser, SLR_REDUCE, next.value, prod.n_rhs);
+            // deal with the incoming tok in the next iteration
+        } else /* Empty Cell, Reject */ {
+            log_debug("Reject due to the empty cell");
+            slr_parser_push_token(parser, tok, SLR_SYMBOL_TOKEN, 0);
+            slr_parser_record(parser, SLR_EMPTY, 0, 0);
+            return PARSER_REJECT;
+        }
+    }
+}
+
+/**
+ * Drive the parser over a whole token buffer, comments are skipped and an
+ * invalid token rejects the input.
+ * @param parser
+ * @param tokens tokens produced by `lexer_tokenize_all`
+ * @param pos (nullable) index of the token where the parser stopped
+ * @return the state after the last consumed token
+ */
+ParserState slr_parser_parse_buffer(SLRParser *parser,
+                                    const TokenBuffer *tokens, size_t *pos) {
+    ParserState state = PARSER_IDLE;
+    size_t i = 0;
+    for (; i < tokens->size; i++) {
+        TokenTy ty = (TokenTy)tokens->ty[i];
+        if (ty == Comment) {
+            continue;
+        }
+        if (ty == Invalid) {
+            state = PARSER_REJECT;
+            break;
         }
-        // Node construction is done, push to the tree
-        parse_tree_node_add_last(parser->parse_tree, node);
-        // Push the lhs item to the stack
-        cc_deque_get_last(parser->stack, (void *)&last);
-        SLRop op = goto_table_get(parser->table->goto_table, last->value,
-                                  prod.lhs.value.nt);
-        SLRItem *item =
-            slr_item_nt(prod.lhs.value.nt, SLR_SYMBOL_NON_TERMINAL, op.value);
-        log_debug("(GOTO, %d)", op.value);
-        cc_deque_add_last(parser->stack, (void *)item);
-        // Display the SLR Stack
-        cc_deque_add_last(parser->trace->stack_trace,
-                          (void *)stringify_slr_stack(parser));
-        cc_deque_add_last(parser->trace->op_trace,
-                          (void *)stringify_slr_op(&next, parser->grammar));
-        // deal with the incoming tok
-        return slr_parser_step(parser, tok);
-    } else /* Empty Cell, Reject */ {
-        log_debug("Reject due to the empty cell");
-        SLRItem *item = slr_item_token(tok, SLR_SYMBOL_TOKEN, 0);
-        cc_deque_add_last(parser->stack, (void *)item);
-        cc_deque_add_last(parser->trace->stack_trace,
-                          (void *)stringify_slr_stack(parser));
-        cc_deque_add_last(parser->trace->op_trace,
-                          (void *)to_string("syntax error"));
-        return PARSER_REJECT;
-    }
-    return PARSER_IDLE;
-}
-
-SLRop shift_reduce_table_get(const SLRop (*shift_reduce_table)[16],
-                             unsigned state_id, TokenTy ty) {
+        state = slr_parser_step(parser, token_buffer_get(tokens, i));
+        if (state != PARSER_IDLE) {
+            break;
+        }
+    }
+    if (pos != NULL) {
+        *pos = i;
+    }
+    return state;
+}
+
+SLRop shift_reduce_table_get(const SLRTable *table, unsigned state_id,
+                             TokenTy ty) {
     // mapping a terminal to table column index
     unsigned symbol_idx = 0;
     switch (ty) {
@@ -287,11 +493,19 @@ SLRop shift_reduce_table_get(const SLRop (*shift_reduce_table)[16],
             __builtin_unreachable();
     }
     log_debug("Checking Shift-Reduce Table [%d, %d]", state_id, symbol_idx);
-    return shift_reduce_table[state_id][symbol_idx];
+    unsigned i = table->base[state_id] + symbol_idx;
+    int16_t cell = table->check[i] == (int16_t)state_id
+                       ? table->next[i]
+                       : table->default_reduction[state_id];
+    if (cell > 0) {
+        return (SLRop){SLR_SHIFT, (unsigned)cell};
+    } else if (cell < 0) {
+        return (SLRop){SLR_REDUCE, (unsigned)(-cell - 1)};
+    }
+    return (SLRop){SLR_EMPTY, 0};
 }
 
-SLRop goto_table_get(const SLRop (*goto_table)[9], unsigned state_id,
-                     NonTerminal nt) {
+SLRop goto_table_get(const SLRTable *table, unsigned state_id, NonTerminal nt) {
     // mapping a non-terminal to table column index
     unsigned symbol_idx = 0;
     switch (nt) {
@@ -325,7 +539,12 @@ SLRop goto_table_get(const SLRop (*goto_table)[9], unsigned state_id,
         default:
             __builtin_unreachable();
     }
-    return goto_table[state_id][symbol_idx];
+    // no default for the gotos
+    unsigned i = table->base[state_id] + SLR_N_TERMINALS + symbol_idx;
+    if (table->check[i] == (int16_t)state_id) {
+        return (SLRop){SLR_GOTO, (unsigned)table->next[i]};
+    }
+    return (SLRop){SLR_EMPTY, 0};
 }
 
 StringBuilder *string_builder_init() {
@@ -388,26 +607,22 @@ char *string_builder_build(StringBuilder *sb) {
 
 SLRTrace *slr_trace_init() {
     SLRTrace *trace = malloc(sizeof(SLRTrace));
-    cc_deque_new(&trace->op_trace);
-    cc_deque_new(&trace->stack_trace);
+    trace->capacity = 64;
+    trace->size = 0;
+    trace->steps = malloc(sizeof(SLRTraceStep) * trace->capacity);
     return trace;
 }
 
 void destroy_slr_trace(SLRTrace *trace) {
-    cc_deque_destroy_cb(trace->op_trace, free);
-    cc_deque_destroy_cb(trace->stack_trace, free);
+    free(trace->steps);
     free(trace);
 }
 
 char *stringify_slr_stack(SLRParser *parser) {
     StringBuilder *sb = string_builder_init();
-    SLRItem *el = NULL;
-    size_t deque_sz = cc_deque_size(parser->stack);
-    for (size_t i = 0; i < deque_sz; i++) {
-        cc_deque_get_at(parser->stack, i, (void *)&el);
-        // assert(el != NULL);
-        stringify_slr_item(el, sb);
-        if (i != deque_sz - 1) {
+    for (size_t i = 0; i < parser->stack_size; i++) {
+        stringify_slr_item(&parser->stack[i], sb);
+        if (i != parser->stack_size - 1) {
             string_builder_append(sb, ", ");
         }
     }
@@ -510,8 +725,8 @@ char *stringify_slr_op(SLRop *action, Grammar *grammar) {
     return string_builder_build(sb);
 }
 
-void stringify_slr_item(SLRItem *item, StringBuilder *sb) {
-    if (item->ty == SLR_SYMBOL_TOKEN && item->symbol->token->ty == Eof) {
+void stringify_slr_item(const SLRItem *item, StringBuilder *sb) {
+    if (item->ty == SLR_SYMBOL_TOKEN && item->symbol.token.ty == Eof) {
         string_builder_append(sb, "$");
         return;
     }
@@ -523,9 +738,9 @@ void stringify_slr_item(SLRItem *item, StringBuilder *sb) {
 
     string_builder_append(sb, "(");
     if (item->ty == SLR_SYMBOL_TOKEN) {
-        string_builder_append(sb, stringify_token_ty(item->symbol->token->ty));
+        string_builder_append(sb, stringify_token_ty(item->symbol.token.ty));
     } else if (item->ty == SLR_SYMBOL_NON_TERMINAL) {
-        string_builder_append_fmt(sb, "%c", item->symbol->nt);
+        string_builder_append_fmt(sb, "%c", item->symbol.nt);
     } else {
         return;
     }
@@ -534,33 +749,55 @@ void stringify_slr_item(SLRItem *item, StringBuilder *sb) {
     string_builder_append(sb, ")");
 }
 
+char *stringify_slr_trace_step(const SLRTraceStep *step, Grammar *grammar) {
+    if (step->op == SLR_EMPTY) {
+        return to_string("syntax error");
+    }
+    if (step->op == SLR_REDUCE && step->value == 0) {
+        return to_string("accept");
+    }
+    SLRop op = {.ty = (SLRopTy)step->op, .value = step->value};
+    return stringify_slr_op(&op, grammar);
+}
+
 void slr_parser_display_trace(SLRParser *parser, FILE *fp) {
-    // assert(cc_deque_size(parser->trace->stack_trace) ==
-    // cc_deque_size(parser->trace->op_trace));
-    char *op_trace_buf = NULL;
-    char *stack_trace_buf = NULL;
-
-    unsigned stack_trace_max_len = 0;
-    for (size_t i = 0; i < cc_deque_size(parser->trace->stack_trace); i++) {
-        cc_deque_get_at(parser->trace->stack_trace, i,
-                        (void *)&stack_trace_buf);
-        stack_trace_max_len = stack_trace_max_len > strlen(stack_trace_buf)
+    if (!parser->tracing) {
+        return;
+    }
+    const SLRTrace *trace = parser->trace;
+    // a first replay finds the width of the stack column
+    SLRTraceReplay replay;
+    slr_trace_replay_init(&replay);
+    unsigned stack_trace_max_len = replay.stack->length;
+    for (size_t i = 0; i < trace->size; i++) {
+        slr_trace_replay_step(&replay, &trace->steps[i]);
+        stack_trace_max_len = stack_trace_max_len > replay.stack->length
                                   ? stack_trace_max_len
-                                  : strlen(stack_trace_buf);
+                                  : replay.stack->length;
     }
-
-    unsigned digit_len = log10u(cc_deque_size(parser->trace->stack_trace));
-    for (size_t i = 0; i < cc_deque_size(parser->trace->stack_trace); i++) {
-        cc_deque_get_at(parser->trace->stack_trace, i,
-                        (void *)&stack_trace_buf);
-        cc_deque_get_at(parser->trace->op_trace, i, (void *)&op_trace_buf);
+    destroy_slr_trace_replay(&replay);
+
+    // the first row is the stack of a new parser, with no operation
+    slr_trace_replay_init(&replay);
+    unsigned digit_len = log10u(trace->size + 1);
+    for (size_t i = 0; i <= trace->size; i++) {
+        char *op_trace_buf;
+        if (i == 0) {
+            op_trace_buf = to_string("");
+        } else {
+            slr_trace_replay_step(&replay, &trace->steps[i - 1]);
+            op_trace_buf =
+                stringify_slr_trace_step(&trace->steps[i - 1], parser->grammar);
+        }
         printf("Step %-*lu:<%*s\t%s\n", digit_len, i, -stack_trace_max_len,
-               stack_trace_buf, op_trace_buf);
+               replay.stack->str, op_trace_buf);
         if (fp != NULL) {
             fprintf(fp, "Step %-*lu:<%*s\t%s\n", digit_len, i,
-                    -stack_trace_max_len, stack_trace_buf, op_trace_buf);
+                    -stack_trace_max_len, replay.stack->str, op_trace_buf);
         }
+        free(op_trace_buf);
     }
+    destroy_slr_trace_replay(&replay);
 }
 
 /**
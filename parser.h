@@ -208,27 +208,65 @@ typedef struct SLRop {
     unsigned value;
 } SLRop;
 
+#define SLR_N_TERMINALS 16     // the columns of the actions
+#define SLR_N_NON_TERMINALS 9  // the columns of the gotos, after the actions
+
+/**
+ * The action and goto tables, compressed by table/SLR.py. A cell is an int16:
+ * a positive shift or goto state, a negative reduce `-(production + 1)`, the
+ * accept being -1, or zero for an error. The rows of all the states are
+ * combed into `next`, a row starting at the `base` of its state, and a cell
+ * belongs to a state when `check` holds that state. The action cells left
+ * out of a row are the default reduction of the state, or errors when it
+ * has none.
+ */
 typedef struct SLRTable {
-    const SLRop (*goto_table)[9];           // 9 non-terminals
-    const SLRop (*shift_reduce_table)[16];  // 16 tokens
+    const int16_t *base;               // per state
+    const int16_t *default_reduction;  // per state, 0: none
+    const int16_t *next;
+    const int16_t *check;
 } SLRTable;
 
+/* An entry of the parser stack, held by value */
 typedef struct SLRItem {
-    SLRSymbol *symbol;  // Non-terminal or Token
-    SLRSymbolTy ty;     // the type of the symbol
-    unsigned value;
+    SLRSymbol symbol;  // Non-terminal or Token
+    SLRSymbolTy ty;    // the type of the symbol
+    unsigned value;    // the state
 } SLRItem;
 
+#define SLR_STACK_INITIAL_CAPACITY 64
+
+/**
+ * One step of the parser, the text of the stack is rebuilt from the steps
+ * only when the trace is displayed
+ */
+typedef struct SLRTraceStep {
+    uint8_t op;       // SLRopTy, SLR_EMPTY for a syntax error
+    uint8_t symbol;   // TokenTy or NonTerminal of the pushed entry
+    uint16_t popped;  // entries popped before the push
+    uint16_t state;   // state of the pushed entry
+    uint16_t value;   // value of the op
+} SLRTraceStep;
+
 typedef struct SLRTrace {
-    CC_Deque *stack_trace;  // deque of <char*>
-    CC_Deque *op_trace;     // deque of <char*>
+    SLRTraceStep *steps;
+    size_t size;
+    size_t capacity;
 } SLRTrace;
 
+typedef struct SLRTraceStream SLRTraceStream;
+
+#define SLR_TRACE_STREAM_BUFFER_SIZE (64u << 10)
+
 typedef struct SLRParser {
     const SLRTable *table;
     Grammar *grammar;
-    CC_Deque *stack;  // <SLRItem*>
+    SLRItem *stack;  // contiguous, the bottom first
+    size_t stack_size;
+    size_t stack_capacity;
     SLRTrace *trace;
+    bool tracing;
+    SLRTraceStream *stream;  // nullable, see `slr_parser_stream_trace`
     ParseTreeNode *parse_tree;
 } SLRParser;
 
@@ -245,27 +283,52 @@ typedef struct StringBuilder {
 } StringBuilder;
 
 // clang-format off
-static const struct SLRop SHIFT_REDUCE_TABLE[38][16] = {{{SLR_EMPTY, 0},{SLR_SHIFT, 4},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 0}},{{SLR_SHIFT, 9},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 2}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 10},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 11},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_REDUCE, 9},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 13},{SLR_SHIFT, 14},{SLR_REDUCE, 9}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 15},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_REDUCE, 14},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 14},{SLR_REDUCE, 14},{SLR_REDUCE, 14},{SLR_REDUCE, 14},{SLR_REDUCE, 14},{SLR_SHIFT, 16},{SLR_REDUCE, 14},{SLR_REDUCE, 14},{SLR_REDUCE, 14},{SLR_REDUCE, 14}},{{SLR_EMPTY, 0},{SLR_SHIFT, 4},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 20},{SLR_SHIFT, 21},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 17},{SLR_EMPTY, 0},{SLR_REDUCE, 17},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 18},{SLR_EMPTY, 0},{SLR_REDUCE, 18},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 1}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 27},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 28},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 6},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 7},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 29},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 16},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 30},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 31},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_REDUCE, 12},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_REDUCE, 13},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 13},{SLR_REDUCE, 13},{SLR_REDUCE, 13},{SLR_REDUCE, 13},{SLR_REDUCE, 13},{SLR_EMPTY, 0},{SLR_REDUCE, 13},{SLR_REDUCE, 13},{SLR_REDUCE, 13},{SLR_REDUCE, 13}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 5},{SLR_SHIFT, 20},{SLR_SHIFT, 21},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 7},{SLR_EMPTY, 0},{SLR_SHIFT, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_REDUCE, 10},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 10},{SLR_REDUCE, 10},{SLR_REDUCE, 10},{SLR_REDUCE, 10},{SLR_REDUCE, 10},{SLR_EMPTY, 0},{SLR_REDUCE, 10},{SLR_REDUCE, 10},{SLR_REDUCE, 10},{SLR_REDUCE, 10}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 11},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_REDUCE, 3},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 4},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_REDUCE, 8},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 8}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_REDUCE, 15},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_SHIFT, 13},{SLR_SHIFT, 14},{SLR_EMPTY, 0}}};
-static const struct SLRop GOTO_TABLE[38][9] = {{{SLR_GOTO, 1},{SLR_GOTO, 2},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 3},{SLR_GOTO, 6},{SLR_EMPTY, 0},{SLR_GOTO, 5},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 12}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_GOTO, 17},{SLR_GOTO, 2},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 3},{SLR_GOTO, 6},{SLR_EMPTY, 0},{SLR_GOTO, 5},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 18},{SLR_GOTO, 19},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 22},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 23},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 25},{SLR_GOTO, 24},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 26},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 25},{SLR_GOTO, 32},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 33},{SLR_GOTO, 6},{SLR_EMPTY, 0},{SLR_GOTO, 5},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 34},{SLR_GOTO, 19},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 35},{SLR_GOTO, 6},{SLR_EMPTY, 0},{SLR_GOTO, 5},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 37},{SLR_EMPTY, 0},{SLR_GOTO, 36},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0}},{{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_EMPTY, 0},{SLR_GOTO, 12}}};
+static const int16_t SLR_BASE[38] = {0,14,0,0,0,0,48,1,0,14,0,57,58,0,0,35,61,0,4,7,0,0,6,20,24,38,0,18,45,32,4,0,0,0,0,0,0,60};
+static const int16_t SLR_DEFAULT_REDUCTION[38] = {0,0,0,-3,0,0,-10,0,-15,0,0,0,0,-18,-19,0,0,-2,0,0,-7,-8,0,-17,0,-13,-14,0,-6,0,0,-11,-12,-4,-5,-9,-16,0};
+static const int16_t SLR_NEXT[86] = {9,4,10,15,20,21,11,27,7,28,8,16,7,29,8,4,1,2,18,19,3,6,7,5,8,37,7,36,8,-1,17,2,30,31,3,6,0,5,33,6,7,5,8,7,0,8,7,0,8,20,21,0,35,6,0,5,25,24,0,25,32,13,14,34,19,7,7,8,8,7,0,8,12,13,14,0,0,0,22,23,0,0,26,0,12,0};
+static const int16_t SLR_CHECK[86] = {2,0,4,7,10,10,5,18,0,19,0,8,30,22,30,9,0,0,10,10,0,0,9,0,9,30,27,30,27,1,9,9,23,24,9,9,-1,9,27,27,29,27,29,15,-1,15,25,-1,25,28,28,-1,29,29,-1,29,15,15,-1,25,25,6,6,28,28,11,12,11,12,16,-1,16,6,37,37,-1,-1,-1,11,12,-1,-1,16,-1,37,-1};
 // clang-format on
 
 static const struct SLRTable SLR_TABLE = {
-    GOTO_TABLE,
-    SHIFT_REDUCE_TABLE,
+    SLR_BASE,
+    SLR_DEFAULT_REDUCTION,
+    SLR_NEXT,
+    SLR_CHECK,
 };
 
-SLRItem *slr_item_init(SLRSymbol symbol, SLRSymbolTy ty, unsigned value);
-
 SLRParser *slr_parser_init(Grammar *grammar, const SLRTable *table);
 void destroy_slr_parser(SLRParser *parser);
-ParserState slr_parser_step(SLRParser *parser, Token *tok);
+/**
+ * Turn the trace on or off, it is on by default. Turning it off drops what
+ * has been recorded, `slr_parser_display_trace` then prints nothing.
+ * @param parser
+ * @param enabled
+ */
+void slr_parser_trace(SLRParser *parser, bool enabled);
+/**
+ * Write the trace to `fp` while parsing instead of recording it, the memory
+ * stays proportional to the depth of the stack whatever the number of steps.
+ * Rows look like those of `slr_parser_display_trace`, but the widths of the
+ * columns cannot be known ahead: they are either fixed, a longer cell
+ * overflowing its column, or adaptive, a column widening to the widest cell
+ * so far. The rows go through a buffer, flushed when the parse is over and
+ * when the parser is destroyed. To be called before the first step.
+ * @param parser
+ * @param fp the only destination of the rows, not closed by the parser
+ * @param step_width digits of the step column, 0: adaptive
+ * @param stack_width characters of the stack column, 0: adaptive
+ */
+void slr_parser_stream_trace(SLRParser *parser, FILE *fp, unsigned step_width,
+                             unsigned stack_width);
+ParserState slr_parser_step(SLRParser *parser, TokenView tok);
+ParserState slr_parser_parse_buffer(SLRParser *parser,
+                                    const TokenBuffer *tokens, size_t *pos);
 void slr_parser_display_trace(SLRParser *parser, FILE *fp);
 ParseTree *slr_parser_parse_tree(SLRParser *parser);
 
-SLRop goto_table_get(const SLRop (*goto_table)[9], unsigned state_id,
-                     NonTerminal nt);
-SLRop shift_reduce_table_get(const SLRop (*shift_reduce_table)[16],
-                             unsigned state_id, TokenTy ty);
+SLRop goto_table_get(const SLRTable *table, unsigned state_id, NonTerminal nt);
+SLRop shift_reduce_table_get(const SLRTable *table, unsigned state_id,
+                             TokenTy ty);
 
 StringBuilder *string_builder_init();
 void string_builder_append(StringBuilder *sb, const char *s);
@@ -275,6 +338,7 @@ SLRTrace *slr_trace_init();
 void destroy_slr_trace(SLRTrace *trace);
 char *stringify_slr_stack(SLRParser *parser);
 char *stringify_slr_op(SLRop *action, Grammar *grammar);
-void stringify_slr_item(SLRItem *item, StringBuilder *sb);
+char *stringify_slr_trace_step(const SLRTraceStep *step, Grammar *grammar);
+void stringify_slr_item(const SLRItem *item, StringBuilder *sb);
 
 #endif  // MINI_COMPILER_PARSER_H
@@ -0,0 +1,204 @@
+#include "pipeline.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+TokenRing *token_ring_new(size_t capacity) {
+    if (capacity == 0) {
+        capacity = TOKEN_RING_DEFAULT_CAPACITY;
+    }
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    TokenRing *ring = (TokenRing *)aligned_alloc(
+        TOKEN_RING_LINE,
+        (sizeof(TokenRing) + TOKEN_RING_LINE - 1) & ~(TOKEN_RING_LINE - 1));
+    ring->slots = (TokenView *)malloc(sizeof(TokenView) * rounded);
+    ring->mask = rounded - 1;
+    atomic_init(&ring->head, 0);
+    ring->tail_cache = 0;
+    ring->full_waits = 0;
+    atomic_init(&ring->tail, 0);
+    ring->head_cache = 0;
+    ring->empty_waits = 0;
+    atomic_init(&ring->closed, false);
+    return ring;
+}
+
+size_t token_ring_push(TokenRing *ring, const TokenView *tokens, size_t n) {
+    size_t capacity = ring->mask + 1;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t pushed = 0;
+    while (pushed < n) {
+        if (head - ring->tail_cache == capacity) {
+            ring->tail_cache =
+                atomic_load_explicit(&ring->tail, memory_order_acquire);
+            if (head - ring->tail_cache == capacity) {
+                if (atomic_load_explicit(&ring->closed,
+                                         memory_order_acquire)) {
+                    break;
+                }
+                ring->full_waits++;
+                sched_yield();
+                continue;
+            }
+        }
+        // up to the end of the free space or of the slots, whichever is first
+        size_t room = capacity - (head - ring->tail_cache);
+        size_t until_wrap = capacity - (head & ring->mask);
+        size_t chunk = n - pushed;
+        chunk = chunk < room ? chunk : room;
+        chunk = chunk < until_wrap ? chunk : until_wrap;
+        memcpy(ring->slots + (head & ring->mask), tokens + pushed,
+               sizeof(TokenView) * chunk);
+        head += chunk;
+        pushed += chunk;
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+    return pushed;
+}
+
+size_t token_ring_pop(TokenRing *ring, TokenView *out, size_t max) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (ring->head_cache == tail) {
+        // `closed` is read before `head`, a token pushed before the ring was
+        // closed is never missed
+        bool closed =
+            atomic_load_explicit(&ring->closed, memory_order_acquire);
+        ring->head_cache =
+            atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (ring->head_cache != tail) {
+            break;
+        }
+        if (closed) {
+            return 0;
+        }
+        ring->empty_waits++;
+        sched_yield();
+    }
+    size_t available = ring->head_cache - tail;
+    size_t until_wrap = ring->mask + 1 - (tail & ring->mask);
+    size_t n = max < available ? max : available;
+    n = n < until_wrap ? n : until_wrap;
+    memcpy(out, ring->slots + (tail & ring->mask), sizeof(TokenView) * n);
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    return n;
+}
+
+void token_ring_close(TokenRing *ring) {
+    atomic_store_explicit(&ring->closed, true, memory_order_release);
+}
+
+void destroy_token_ring(TokenRing *ring) {
+    free(ring->slots);
+    free(ring);
+}
+
+typedef struct LexProducer {
+    TokenRing *ring;
+    const char *src;
+    unsigned len;
+    Interner *interner;
+    size_t batch;
+} LexProducer;
+
+/* Lexer thread: lex and publish batches until Eof, Invalid or a close */
+static void *lex_producer(void *arg) {
+    LexProducer *producer = (LexProducer *)arg;
+    Lexer *lexer = lexer_new_n(producer->src, producer->len);
+    lexer->interner = producer->interner;
+    lexer_skip_comments(lexer, true);
+    TokenView *batch =
+        (TokenView *)malloc(sizeof(TokenView) * producer->batch);
+    bool done = false;
+    while (!done) {
+        size_t n = 0;
+        while (n < producer->batch && !done) {
+            TokenView tok = lexer_next_view(lexer);
+            batch[n++] = tok;
+            done = tok.ty == Eof || tok.ty == Invalid;
+        }
+        if (token_ring_push(producer->ring, batch, n) < n) {
+            break;
+        }
+    }
+    token_ring_close(producer->ring);
+    free(batch);
+    destroy_lexer(lexer);
+    return NULL;
+}
+
+/* Lex and parse on the calling thread, token by token */
+static ParserState parse_interleaved(SLRParser *parser, const char *src,
+                                     unsigned len, Interner *interner,
+                                     TokenView *last) {
+    Lexer *lexer = lexer_new_n(src, len);
+    lexer->interner = interner;
+    lexer_skip_comments(lexer, true);
+    ParserState state;
+    TokenView tok;
+    do {
+        tok = lexer_next_view(lexer);
+        if (tok.ty == Invalid) {
+            state = PARSER_REJECT;
+            break;
+        }
+        state = slr_parser_step(parser, tok);
+    } while (state == PARSER_IDLE);
+    destroy_lexer(lexer);
+    if (last != NULL) {
+        *last = tok;
+    }
+    return state;
+}
+
+ParserState slr_parser_parse_pipelined(SLRParser *parser, const char *src,
+                                       unsigned len, Interner *interner,
+                                       size_t capacity, size_t batch,
+                                       TokenView *last) {
+    LexProducer producer = {
+        .ring = token_ring_new(capacity),
+        .src = src,
+        .len = len,
+        .interner = interner,
+        .batch = batch == 0 ? TOKEN_RING_DEFAULT_BATCH : batch,
+    };
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, lex_producer, &producer) != 0) {
+        // no thread to spare
+        destroy_token_ring(producer.ring);
+        return parse_interleaved(parser, src, len, interner, last);
+    }
+
+    TokenView *tokens =
+        (TokenView *)malloc(sizeof(TokenView) * producer.batch);
+    ParserState state = PARSER_IDLE;
+    TokenView tok = {0};
+    size_t n;
+    while (state == PARSER_IDLE &&
+           (n = token_ring_pop(producer.ring, tokens, producer.batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            tok = tokens[i];
+            if (tok.ty == Invalid) {
+                state = PARSER_REJECT;
+                break;
+            }
+            state = slr_parser_step(parser, tok);
+            if (state != PARSER_IDLE) {
+                break;
+            }
+        }
+    }
+    // unblock the lexer if the parser stopped before Eof
+    token_ring_close(producer.ring);
+    pthread_join(thread, NULL);
+    free(tokens);
+    destroy_token_ring(producer.ring);
+    if (last != NULL) {
+        *last = tok;
+    }
+    return state;
+}
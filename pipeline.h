@@ -0,0 +1,96 @@
+#ifndef MINI_COMPILER_PIPELINE_H
+#define MINI_COMPILER_PIPELINE_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lexer.h"
+#include "parser.h"
+
+#define TOKEN_RING_DEFAULT_CAPACITY 4096 /* tokens, a power of two */
+#define TOKEN_RING_DEFAULT_BATCH 256
+
+/* producer and consumer state live on separate cache lines */
+#define TOKEN_RING_LINE 64
+
+/**
+ * Lock-free single-producer/single-consumer ring of tokens. The producer
+ * appends at `head`, the consumer removes at `tail`, both only ever grow and
+ * are reduced modulo the capacity. Each side caches the last index it read
+ * from the other one and only reloads it when the ring looks full (empty).
+ * Either side may `close` the ring: the producer once it has pushed its last
+ * token, the consumer when it stops early.
+ */
+typedef struct TokenRing {
+    TokenView *slots;
+    size_t mask; /* capacity - 1 */
+
+    alignas(TOKEN_RING_LINE) atomic_size_t head; /* written by the producer */
+    size_t tail_cache; /* last `tail` seen by the producer */
+    size_t full_waits; /* times the producer waited for room */
+
+    alignas(TOKEN_RING_LINE) atomic_size_t tail; /* written by the consumer */
+    size_t head_cache;  /* last `head` seen by the consumer */
+    size_t empty_waits; /* times the consumer waited for tokens */
+
+    alignas(TOKEN_RING_LINE) atomic_bool closed;
+} TokenRing;
+
+/**
+ * Create an empty ring
+ * @param capacity number of slots, rounded up to a power of two, 0 for
+ * TOKEN_RING_DEFAULT_CAPACITY
+ * @return the ring
+ */
+TokenRing *token_ring_new(size_t capacity);
+
+/**
+ * Append tokens, waiting for room while the ring is full (backpressure).
+ * They are published to the consumer as one batch per contiguous free range.
+ * Producer side only.
+ * @param ring
+ * @param tokens
+ * @param n
+ * @return number of tokens appended, less than `n` iff the ring was closed
+ */
+size_t token_ring_push(TokenRing *ring, const TokenView *tokens, size_t n);
+
+/**
+ * Remove up to `max` tokens, waiting while the ring is empty and open.
+ * Consumer side only.
+ * @param ring
+ * @param out
+ * @param max
+ * @return number of tokens removed, 0 once the ring is closed and drained
+ */
+size_t token_ring_pop(TokenRing *ring, TokenView *out, size_t max);
+
+/* Wake up the other side, nothing can be pushed after this */
+void token_ring_close(TokenRing *ring);
+void destroy_token_ring(TokenRing *ring);
+
+/**
+ * Lex and parse a source on two threads: a lexer thread fills a `TokenRing`
+ * in batches and the calling thread drains it through `slr_parser_step`.
+ * Comments are skipped and an invalid token rejects the input, as in
+ * `slr_parser_parse_buffer`. The lexer thread is stopped and joined before
+ * returning, whatever the outcome. When no thread can be created, the source
+ * is lexed and parsed token by token on the calling thread.
+ * @param parser
+ * @param src pointer to the first byte of the source
+ * @param len length of the source
+ * @param interner interner of the identifiers, NULL to not intern them. It
+ * is only touched by the lexer thread until the call returns.
+ * @param capacity slots of the ring, 0 for the default
+ * @param batch tokens lexed between two publications, 0 for the default
+ * @param last (nullable) the token the parser stopped at
+ * @return the state after the last consumed token
+ */
+ParserState slr_parser_parse_pipelined(SLRParser *parser, const char *src,
+                                       unsigned len, Interner *interner,
+                                       size_t capacity, size_t batch,
+                                       TokenView *last);
+
+#endif  // MINI_COMPILER_PIPELINE_H
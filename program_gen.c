@@ -0,0 +1,341 @@
+#include "program_gen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Programs are derived from the grammar with an explicit stack of symbols
+ * instead of recursion, so the nesting depth is only bounded by memory.
+ * Every body has a spine: a chain of expressions which always nests further
+ * until `depth` is reached. Everything off the spine nests with a small
+ * probability, which keeps the size of a body proportional to the depth.
+ */
+
+typedef enum GenSym {
+    /* non-terminals */
+    GEN_C,
+    GEN_B,
+    GEN_E,
+    GEN_I,
+    GEN_A,
+    GEN_T,
+    GEN_R,
+    GEN_ID,
+    GEN_LIT,
+    /* terminals, see `TERMINALS` */
+    GEN_QUESTION_MARK,
+    GEN_COLON,
+    GEN_AMPERSAND,
+    GEN_LEFT_PAREN,
+    GEN_RIGHT_PAREN,
+    GEN_PLUS,
+} GenSym;
+
+static const char *TERMINALS[] = {
+    [GEN_QUESTION_MARK] = "?", [GEN_COLON] = ":",       [GEN_AMPERSAND] = "&",
+    [GEN_LEFT_PAREN] = "(",    [GEN_RIGHT_PAREN] = ")", [GEN_PLUS] = "+",
+};
+
+static const char *COMMENT_WORDS[] = {
+    "the", "base", "case", "returns", "zero", "otherwise", "recurse", "on",
+    "a",   "smaller", "argument", "note", "todo", "check", "overflow",
+};
+
+typedef struct GenItem {
+    unsigned depth; /* nesting of the expression the symbol belongs to */
+    uint8_t sym;    /* GenSym */
+    bool spine;
+} GenItem;
+
+typedef struct Gen {
+    const ProgramGenConf *conf;
+    uint64_t rng;
+    char *buf;
+    size_t len;
+    size_t capacity;
+    GenItem *stack;
+    size_t stack_size;
+    size_t stack_capacity;
+} Gen;
+
+/* splitmix64, every seed (0 included) gives a well mixed state */
+static uint64_t gen_rand(Gen *gen) {
+    uint64_t z = (gen->rng += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* true with probability 1/n */
+static bool gen_one_in(Gen *gen, unsigned n) {
+    return gen_rand(gen) % n == 0;
+}
+
+static void gen_reserve(Gen *gen, size_t n) {
+    if (gen->len + n + 1 <= gen->capacity) {
+        return;
+    }
+    while (gen->len + n + 1 > gen->capacity) {
+        gen->capacity *= 2;
+    }
+    gen->buf = (char *)realloc(gen->buf, gen->capacity);
+}
+
+static void gen_append(Gen *gen, const char *s, size_t n) {
+    gen_reserve(gen, n);
+    memcpy(gen->buf + gen->len, s, n);
+    gen->len += n;
+}
+
+static void gen_comment(Gen *gen) {
+    size_t n_words = sizeof(COMMENT_WORDS) / sizeof(COMMENT_WORDS[0]);
+    gen_append(gen, "[", 1);
+    for (unsigned i = gen_rand(gen) % 8; i > 0; i--) {
+        const char *word = COMMENT_WORDS[gen_rand(gen) % n_words];
+        gen_append(gen, " ", 1);
+        gen_append(gen, word, strlen(word));
+    }
+    gen_append(gen, " ] ", 3);
+}
+
+/* A token followed by a space, and by a comment every now and then */
+static void gen_token(Gen *gen, const char *s, size_t n) {
+    gen_append(gen, s, n);
+    gen_append(gen, " ", 1);
+    if (gen->conf->comment_density > 0 &&
+        gen_rand(gen) % 100 < gen->conf->comment_density) {
+        gen_comment(gen);
+    }
+}
+
+static void gen_identifier(Gen *gen) {
+    char name[16];
+    unsigned n_identifiers =
+        gen->conf->n_identifiers > 0 ? gen->conf->n_identifiers : 1;
+    unsigned id = (unsigned)(gen_rand(gen) % n_identifiers);
+    int n = snprintf(name, sizeof(name), "x%u", id);
+    gen_token(gen, name, n);
+}
+
+static void gen_literal(Gen *gen) {
+    uint64_t r = gen_rand(gen);
+    if (r % 8 == 0) {
+        gen_token(gen, r & 8 ? "T" : "F", 1);
+        return;
+    }
+    char digits[16];
+    int n =
+        snprintf(digits, sizeof(digits), "%u", (unsigned)(r >> 32) % 1000);
+    gen_token(gen, digits, n);
+}
+
+static void gen_push(Gen *gen, GenSym sym, unsigned depth, bool spine) {
+    if (gen->stack_size == gen->stack_capacity) {
+        gen->stack_capacity *= 2;
+        gen->stack = (GenItem *)realloc(
+            gen->stack, sizeof(GenItem) * gen->stack_capacity);
+    }
+    gen->stack[gen->stack_size++] =
+        (GenItem){.depth = depth, .sym = sym, .spine = spine};
+}
+
+/* Expand an expression, its symbols are pushed right to left */
+static void gen_expand_e(Gen *gen, GenItem item) {
+    bool nest = item.depth < gen->conf->depth &&
+                (item.spine || gen_one_in(gen, 4));
+    if (!nest) {
+        gen_literal(gen);
+    } else if (gen_one_in(gen, 2)) {
+        // E -> ( id I )
+        gen_push(gen, GEN_RIGHT_PAREN, item.depth, false);
+        gen_push(gen, GEN_I, item.depth + 1, item.spine);
+        gen_push(gen, GEN_ID, item.depth, false);
+        gen_push(gen, GEN_LEFT_PAREN, item.depth, false);
+    } else {
+        // E -> lit + E
+        gen_push(gen, GEN_E, item.depth + 1, item.spine);
+        gen_push(gen, GEN_PLUS, item.depth, false);
+        gen_push(gen, GEN_LIT, item.depth, false);
+    }
+}
+
+static void gen_expand(Gen *gen, GenItem item) {
+    switch ((GenSym)item.sym) {
+        case GEN_C:
+            if (gen_one_in(gen, 4)) {
+                // C -> B ? E : C
+                gen_push(gen, GEN_C, item.depth, item.spine);
+                gen_push(gen, GEN_COLON, item.depth, false);
+                gen_push(gen, GEN_E, item.depth, false);
+                gen_push(gen, GEN_QUESTION_MARK, item.depth, false);
+                gen_push(gen, GEN_B, item.depth, false);
+            } else {
+                gen_push(gen, GEN_E, item.depth, item.spine);
+            }
+            break;
+        case GEN_B:
+            if (gen_one_in(gen, 4)) {
+                // B -> E R E & B
+                gen_push(gen, GEN_B, item.depth, false);
+                gen_push(gen, GEN_AMPERSAND, item.depth, false);
+            }
+            gen_push(gen, GEN_E, item.depth, false);
+            gen_push(gen, GEN_R, item.depth, false);
+            gen_push(gen, GEN_E, item.depth, false);
+            break;
+        case GEN_E:
+            gen_expand_e(gen, item);
+            break;
+        case GEN_I: {
+            // I -> E I | E, the first argument carries the spine
+            unsigned n_args = 1;
+            while (n_args < 4 && gen_one_in(gen, 3)) {
+                n_args++;
+            }
+            for (unsigned i = n_args - 1; i > 0; i--) {
+                gen_push(gen, GEN_E, item.depth, false);
+            }
+            gen_push(gen, GEN_E, item.depth, item.spine);
+            break;
+        }
+        case GEN_A: {
+            // A -> T id A | T id
+            unsigned n_params = 1 + (unsigned)(gen_rand(gen) % 4);
+            for (unsigned i = 0; i < n_params; i++) {
+                gen_push(gen, GEN_ID, item.depth, false);
+                gen_push(gen, GEN_T, item.depth, false);
+            }
+            break;
+        }
+        case GEN_T:
+            if (gen_one_in(gen, 2)) {
+                gen_token(gen, "nat", 3);
+            } else {
+                gen_token(gen, "bool", 4);
+            }
+            break;
+        case GEN_R:
+            gen_token(gen, gen_one_in(gen, 2) ? "<" : "=", 1);
+            break;
+        case GEN_ID:
+            gen_identifier(gen);
+            break;
+        case GEN_LIT:
+            gen_literal(gen);
+            break;
+        default:
+            gen_token(gen, TERMINALS[item.sym], 1);
+            break;
+    }
+}
+
+/* Derive everything from `sym` */
+static void gen_derive(Gen *gen, GenSym sym, bool spine) {
+    gen_push(gen, sym, 0, spine);
+    while (gen->stack_size > 0) {
+        gen_expand(gen, gen->stack[--gen->stack_size]);
+    }
+}
+
+/* F -> fun id A -> C */
+static void gen_definition(Gen *gen) {
+    gen_token(gen, "fun", 3);
+    gen_identifier(gen);
+    gen_derive(gen, GEN_A, false);
+    gen_token(gen, "->", 2);
+    gen_derive(gen, GEN_C, true);
+    gen_token(gen, ";", 1);
+    gen_append(gen, "\n", 1);
+}
+
+/*
+ * First position at or after `from` (wrapping around) which is outside
+ * comments and starts with `needle`, `len` if there is none
+ */
+static size_t gen_find(const Gen *gen, size_t from, const char *needle) {
+    size_t n = strlen(needle);
+    size_t found = gen->len;
+    bool in_comment = false;
+    for (size_t i = 0; i + n <= gen->len; i++) {
+        if (in_comment) {
+            in_comment = gen->buf[i] != ']';
+        } else if (gen->buf[i] == '[') {
+            in_comment = true;
+        } else if (memcmp(gen->buf + i, needle, n) == 0) {
+            if (i >= from) {
+                return i;
+            }
+            found = found == gen->len ? i : found;
+        }
+    }
+    return found;
+}
+
+static void gen_mutate(Gen *gen) {
+    size_t from = gen_rand(gen) % (gen->len + 1);
+    size_t at;
+    switch (gen->conf->mutation) {
+        case MUTATION_DROP_ARROW:
+            at = gen_find(gen, from, "->");
+            if (at < gen->len) {
+                memcpy(gen->buf + at, "  ", 2);
+                return;
+            }
+            break;
+        case MUTATION_TRUNCATE:
+            at = gen_find(gen, from, "(");
+            if (at < gen->len) {
+                gen->len = at + 1;
+                return;
+            }
+            break;
+        default:
+            at = gen_find(gen, from, " ");
+            if (at < gen->len) {
+                gen->buf[at] = '#';
+                return;
+            }
+            break;
+    }
+    // nothing to apply the mutation to, fall back to an invalid byte
+    gen_append(gen, " #", 2);
+}
+
+void program_gen_conf_init(ProgramGenConf *conf, uint64_t seed) {
+    conf->seed = seed;
+    conf->size = 64u << 10;
+    conf->n_funs = 0;
+    conf->depth = 4;
+    conf->comment_density = 5;
+    conf->n_identifiers = 256;
+    conf->valid = true;
+    conf->mutation = MUTATION_INVALID_BYTE;
+}
+
+char *program_gen(const ProgramGenConf *conf, size_t *len) {
+    Gen gen = {
+        .conf = conf,
+        .rng = conf->seed,
+        .capacity = 256,
+        .stack_capacity = 64,
+    };
+    gen.buf = (char *)malloc(gen.capacity);
+    gen.stack = (GenItem *)malloc(sizeof(GenItem) * gen.stack_capacity);
+    size_t n_funs = 0;
+    while ((conf->size > 0 || conf->n_funs > 0) &&
+           (conf->size == 0 || gen.len < conf->size) &&
+           (conf->n_funs == 0 || n_funs < conf->n_funs)) {
+        gen_definition(&gen);
+        n_funs++;
+    }
+    gen_derive(&gen, GEN_C, true);
+    gen_append(&gen, "\n", 1);
+    if (!conf->valid) {
+        gen_mutate(&gen);
+    }
+    free(gen.stack);
+    gen.buf[gen.len] = '\0';
+    *len = gen.len;
+    return gen.buf;
+}
@@ -0,0 +1,52 @@
+#ifndef MINI_COMPILER_PROGRAM_GEN_H
+#define MINI_COMPILER_PROGRAM_GEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * How an invalid program is broken, one mutation per program. Each of them
+ * makes the program fail whatever it looked like before.
+ */
+typedef enum ProgramGenMutation {
+    MUTATION_INVALID_BYTE, /* a byte no token starts with, e.g. '#' */
+    MUTATION_DROP_ARROW,   /* the `->` of a definition is removed */
+    MUTATION_TRUNCATE,     /* the source ends right after a `(` */
+    MUTATION_N_KINDS,
+} ProgramGenMutation;
+
+/**
+ * Shape of a generated program: `fun` definitions separated by `;` and a
+ * final expression, as in table/grammar.bnf. The same configuration always
+ * gives the same program.
+ */
+typedef struct ProgramGenConf {
+    uint64_t seed;
+    size_t size;    /* stop after the definition which reaches it, 0: none */
+    size_t n_funs;  /* stop after that many definitions, 0: none */
+    unsigned depth; /* nesting of the deepest expression of every body */
+    unsigned comment_density; /* percent of tokens followed by a comment */
+    unsigned n_identifiers;   /* number of distinct identifiers, at least 1 */
+    bool valid;               /* false: apply one mutation, see below */
+    ProgramGenMutation mutation;
+} ProgramGenConf;
+
+/**
+ * Default configuration: 64 KB of valid code, depth 4, a comment every 20
+ * tokens, 256 identifiers
+ * @param conf out
+ * @param seed
+ */
+void program_gen_conf_init(ProgramGenConf *conf, uint64_t seed);
+
+/**
+ * Generate a program. Without any limit (`size` and `n_funs` both 0) only
+ * the final expression is generated.
+ * @param conf
+ * @param len out, length of the program
+ * @return the program, null terminated, to be freed by the caller
+ */
+char *program_gen(const ProgramGenConf *conf, size_t *len);
+
+#endif  // MINI_COMPILER_PROGRAM_GEN_H
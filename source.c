@@ -0,0 +1,87 @@
+#include "source.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SOURCE_INITIAL_CAPACITY 4096
+
+/* Read `fd` to its end, doubling the buffer whenever it is full */
+static Source *source_read(int fd, size_t capacity) {
+    if (capacity < SOURCE_INITIAL_CAPACITY) {
+        capacity = SOURCE_INITIAL_CAPACITY;
+    }
+    char *data = (char *)malloc(capacity);
+    size_t len = 0;
+    while (data != NULL) {
+        if (len == capacity) {
+            capacity *= 2;
+            char *grown = (char *)realloc(data, capacity);
+            if (grown == NULL) {
+                break;
+            }
+            data = grown;
+        }
+        ssize_t got = read(fd, data + len, capacity - len);
+        if (got > 0) {
+            len += got;
+        } else if (got == 0) {
+            Source *source = (Source *)malloc(sizeof(Source));
+            source->data = data;
+            source->len = len;
+            source->mapped = false;
+            return source;
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    free(data);
+    return NULL;
+}
+
+Source *source_from_fd(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return NULL;
+    }
+    // Files reporting a size of 0 may still have contents (e.g. in /proc),
+    // and an empty mapping is not allowed anyway
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        return source_read(fd, 0);
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        return source_read(fd, st.st_size + 1);
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    Source *source = (Source *)malloc(sizeof(Source));
+    source->data = (const char *)data;
+    source->len = st.st_size;
+    source->mapped = true;
+    return source;
+}
+
+Source *source_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    // the mapping stays valid after the fd is closed
+    Source *source = source_from_fd(fd);
+    close(fd);
+    return source;
+}
+
+void destroy_source(Source *source) {
+    if (source->mapped) {
+        munmap((void *)source->data, source->len);
+    } else {
+        free((void *)source->data);
+    }
+    free(source);
+}
@@ -0,0 +1,34 @@
+#ifndef MINI_COMPILER_SOURCE_H
+#define MINI_COMPILER_SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Bytes of a source file. Regular files are mapped read-only, anything else
+ * (pipes, terminals, ...) is read into a heap buffer. The data is NOT null
+ * terminated, use `len`.
+ */
+typedef struct Source {
+    const char *data;
+    size_t len;
+    bool mapped; /* data is mmap'ed, otherwise malloc'ed */
+} Source;
+
+/**
+ * Load the file at `path`
+ * @param path
+ * @return the source, NULL if the file can't be opened or read
+ */
+Source *source_open(const char *path);
+
+/**
+ * Load everything readable from `fd`, the fd is not closed
+ * @param fd
+ * @return the source, NULL on read error
+ */
+Source *source_from_fd(int fd);
+
+void destroy_source(Source *source);
+
+#endif  // MINI_COMPILER_SOURCE_H
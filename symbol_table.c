@@ -23,7 +23,7 @@ static void walkTreeHelper(Node *root, void (*callback)(Key k));
 /* Comparator and Destructor */
 static int symbolComparator(Key l, Key r);
 static void symbolDestructor(Key k);
-static void symbolWalker(Key k);
+static void symbolWalker(Node *root, const Interner *names);
 
 /**
  * Create a new node
@@ -352,44 +352,36 @@ void destroyTree(AVLTree *tree) {
 }
 
 static int symbolComparator(Key l, Key r) {
-    char *lhs = ((Symbol *)l)->ident;
-    char *rhs = ((Symbol *)r)->ident;
-    return strcmp(lhs, rhs);
+    SymbolId lhs = ((Symbol *)l)->ident;
+    SymbolId rhs = ((Symbol *)r)->ident;
+    return (lhs > rhs) - (lhs < rhs);
 }
 
-static void symbolDestructor(Key k) {
-    // the string is *owned* by symbol
-    free(((Symbol *)k)->ident);
-    free(k);
-}
+static void symbolDestructor(Key k) { free(k); }
 
-Symbol *symbol_new(const char *ident, enum SymbolTy ty) {
+Symbol *symbol_new(SymbolId ident, enum SymbolTy ty) {
     Symbol *s = (Symbol *)malloc(sizeof(Symbol));
-    s->ident = strdup(ident);
+    s->ident = ident;
     s->ty = ty;
     return s;
 }
 
-void symbol_destroy(Symbol *symbol) {
-    free(symbol->ident);
-    free(symbol);
-}
+void symbol_destroy(Symbol *symbol) { free(symbol); }
 
-SymbolTable *symbol_table_new() {
+SymbolTable *symbol_table_new(const Interner *names) {
     SymbolTable *t = (SymbolTable *)malloc(sizeof(SymbolTable));
     t->tree = createTree(symbolComparator, symbolDestructor);
+    t->names = names;
     return t;
 }
 
-void symbol_table_insert(SymbolTable *table, const char *ident, SymbolTy ty) {
+void symbol_table_insert(SymbolTable *table, SymbolId ident, SymbolTy ty) {
     insertNode(table->tree, symbol_new(ident, ty));
 }
 
-SymbolTy symbol_table_find(SymbolTable *table, const char *ident) {
-    Symbol *sym = symbol_new(ident, FuncTy);  // we don't care the ty
-    SymbolTy ret = ((Symbol *)findNode(table->tree, sym))->ty;
-    symbol_destroy(sym);
-    return ret;
+SymbolTy symbol_table_find(SymbolTable *table, SymbolId ident) {
+    Symbol sym = {.ident = ident, .ty = FuncTy};  // we don't care the ty
+    return ((Symbol *)findNode(table->tree, &sym))->ty;
 }
 
 void symbol_table_destroy(SymbolTable *table) {
@@ -412,15 +404,33 @@ char *symbol_ty_name(SymbolTy ty, char *buf, size_t bufsz) {
     return buf;
 }
 
-void symbolWalker(Key k) {
-    Symbol *sym = (Symbol *)k;
-    char buf[16];
-    // printf("Ident(%s) => Type(%s)\n", sym->ident, symbol_ty_name(sym->ty,
-    // buf, sizeof(buf)));
-    printf("Ident(%s)\n",
-           sym->ident);  // TODO: symbol ty is known in syntactic analysis
+static size_t countNodes(const Node *root) {
+    if (root == NULL) return 0;
+    return 1 + countNodes(root->left) + countNodes(root->right);
+}
+
+// same in-order walk as `walkTree`, the callback needs the names
+static const char **collectNames(const Node *root, const Interner *names,
+                                 const char **out) {
+    if (root == NULL) return out;
+    out = collectNames(root->left, names, out);
+    *out++ = interner_name(names, ((Symbol *)root->key)->ident);
+    return collectNames(root->right, names, out);
+}
+
+static int compareNames(const void *l, const void *r) {
+    return strcmp(*(const char *const *)l, *(const char *const *)r);
 }
 
 void symbol_table_walk(SymbolTable *table) {
-    walkTree(table->tree, symbolWalker);
+    // the tree is ordered by interning, the names are printed by name
+    size_t n = countNodes(table->tree->root);
+    const char **sorted = (const char **)malloc(sizeof(char *) * (n + 1));
+    collectNames(table->tree->root, table->names, sorted);
+    qsort(sorted, n, sizeof(char *), compareNames);
+    for (size_t i = 0; i < n; i++) {
+        // TODO: symbol ty is known in syntactic analysis
+        printf("Ident(%s)\n", sorted[i]);
+    }
+    free(sorted);
 }
@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 
+#include "interner.h"
+
 typedef void *Key;
 
 typedef struct Node {
@@ -50,20 +52,32 @@ typedef enum SymbolTy {
 char *symbol_ty_name(SymbolTy ty, char *buf, size_t bufsz);
 
 typedef struct Symbol {
-    char *ident;
+    SymbolId ident;
     enum SymbolTy ty;
 } Symbol;
 
-Symbol *symbol_new(const char *ident, enum SymbolTy ty);
+Symbol *symbol_new(SymbolId ident, enum SymbolTy ty);
 void symbol_destroy(Symbol *symbol);
 
+/**
+ * Symbols are keyed by their interned name, looking one up compares ids
+ * only. The names are only needed to print the table.
+ */
 typedef struct SymbolTable {
     AVLTree *tree;
+    const Interner *names; /* interner the ids come from */
 } SymbolTable;
 
-SymbolTable *symbol_table_new();
-void symbol_table_insert(SymbolTable *table, const char *ident, SymbolTy ty);
-SymbolTy symbol_table_find(SymbolTable *table, const char *ident);
+SymbolTable *symbol_table_new(const Interner *names);
+void symbol_table_insert(SymbolTable *table, SymbolId ident, SymbolTy ty);
+
+/**
+ * Type of a symbol, the symbol must be in the table
+ * @param table
+ * @param ident interned name of the symbol
+ * @return type of the symbol
+ */
+SymbolTy symbol_table_find(SymbolTable *table, SymbolId ident);
 void symbol_table_walk(SymbolTable *table);
 void symbol_table_destroy(SymbolTable *table);
 
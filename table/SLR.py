@@ -1,32 +1,9 @@
 import csv
-from typing import Literal, Tuple
+from collections import Counter
+from typing import Dict, List, Literal, Tuple
 
 NON_TERMINAL = {"S", "F", "A", "T", "C", "E", "I", "B", "R"}
 
-LEFT_CURLY = "{"
-RIGHT_CURLY = "}"
-
-
-class Builder:
-    def __init__(self):
-        self.table = []
-        self.row = []
-
-    def push_cell(
-        self,
-        op: Literal["SLR_SHIFT", "SLR_REDUCE", "SLR_GOTO", "SLR_EMPTY"],
-        value: int,
-    ):
-        self.row.append(f"{LEFT_CURLY}{op}, {value}{RIGHT_CURLY}")
-
-    def new_line(self):
-        joined_row = "{}{}{}".format(LEFT_CURLY, ",".join(self.row), RIGHT_CURLY)
-        self.table.append(joined_row)
-        self.row = []
-
-    def build(self) -> str:
-        return "{}{}{}".format(LEFT_CURLY, ",".join(self.table), RIGHT_CURLY)
-
 
 def parse_ops(
     raw: str
@@ -46,24 +23,89 @@ def parse_ops(
     return ("SLR_EMPTY", 0)
 
 
+def encode(op: str, value: int) -> int:
+    """int16 cell: positive shift or goto, negative reduce, zero error"""
+    if op == "SLR_SHIFT" or op == "SLR_GOTO":
+        return value
+    if op == "SLR_REDUCE":
+        # the accept (reduce 0) must not be zero
+        return -(value + 1)
+    return 0
+
+
+def default_reduction(cells: List[int]) -> int:
+    """The most frequent reduction of a row, never the accept"""
+    reductions = Counter(cell for cell in cells if cell < -1)
+    if len(reductions) == 0:
+        return 0
+    return reductions.most_common(1)[0][0]
+
+
+def comb(rows: List[Dict[int, int]]) -> Tuple[List[int], List[int], List[int]]:
+    """
+    Row displacement: every row is laid in one vector at the first offset
+    where its cells only land on free slots, a cell belongs to the row whose
+    state is in the check vector
+    """
+    n_columns = max((col for row in rows for col in row), default=0) + 1
+    base = [0] * len(rows)
+    next_ = []
+    check = []
+    # the fullest rows first, the sparse ones fill the holes
+    for state in sorted(range(len(rows)), key=lambda s: -len(rows[s])):
+        row = rows[state]
+        offset = 0
+        while any(
+            offset + col < len(check) and check[offset + col] != -1 for col in row
+        ):
+            offset += 1
+        base[state] = offset
+        for col, cell in row.items():
+            while len(check) <= offset + col:
+                next_.append(0)
+                check.append(-1)
+            next_[offset + col] = cell
+            check[offset + col] = state
+    # any state and column can be looked up without a bound check
+    while len(check) < max(base) + n_columns:
+        next_.append(0)
+        check.append(-1)
+    return base, next_, check
+
+
+def c_array(ty: str, name: str, values: List[int]) -> str:
+    return "static const {} {}[{}] = {{{}}};".format(
+        ty, name, len(values), ",".join(str(v) for v in values)
+    )
+
+
 with open("SLR.csv", newline="") as csvfile:
     reader = csv.DictReader(csvfile)
-    shift_reduce = Builder()
-    goto = Builder()
+    defaults = []
+    rows = []
     for row in reader:
+        terminals = []
+        non_terminals = []
         for sym, op in row.items():
-            op, val = parse_ops(op)
-
             if sym == "state" or sym == "S'":
                 continue
-
+            cell = encode(*parse_ops(op))
             if sym in NON_TERMINAL:
-                goto.push_cell(op, val)
+                non_terminals.append(cell)
             else:
-                shift_reduce.push_cell(op, val)
-
-        goto.new_line()
-        shift_reduce.new_line()
-
-    print(shift_reduce.build())
-    print(goto.build())
+                terminals.append(cell)
+
+        # the cells of the default reduction and the errors are left out
+        default = default_reduction(terminals)
+        cells = {}
+        for col, cell in enumerate(terminals + non_terminals):
+            if cell != 0 and (col >= len(terminals) or cell != default):
+                cells[col] = cell
+        defaults.append(default)
+        rows.append(cells)
+
+    base, next_, check = comb(rows)
+    print(c_array("int16_t", "SLR_BASE", base))
+    print(c_array("int16_t", "SLR_DEFAULT_REDUCTION", defaults))
+    print(c_array("int16_t", "SLR_NEXT", next_))
+    print(c_array("int16_t", "SLR_CHECK", check))
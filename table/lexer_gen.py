@@ -0,0 +1,175 @@
+"""Generate a direct-coded version of the lexer DFA.
+
+The transitions are emitted as C code, states become switch cases (for single
+steps) and labels (for runs over a buffer), so no table is looked up. The
+output is a header which lexer.c includes when built with -DLEXER_DIRECT:
+
+    python3 lexer_gen.py > lexer_direct.h
+"""
+
+from typing import Dict, List, Tuple
+
+DIGITS = "0123456789"
+LETTERS = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+
+# Single char tokens, each has an accept state of its own
+PUNCTUATION = "?:;()+&<="
+
+# The token definitions as the states of the DFA. A state is
+# (name, {bytes: next state}, default next state), states are numbered in
+# order and the numbering must be the one of LEXER_TABLE in lexer.c.
+STATES: List[Tuple[str, Dict[str, int], int]] = [
+    ("dead", {}, 0),
+    (
+        "start",
+        {
+            **{c: 9 + i for i, c in enumerate(PUNCTUATION)},
+            "-": 3,
+            "0": 8,
+            DIGITS[1:]: 2,
+            LETTERS: 5,
+            "[": 6,
+        },
+        1,  # anything else is skipped
+    ),
+    ("natural", {DIGITS: 2}, 0),
+    ("minus", {">": 4}, 0),
+    ("arrow", {}, 0),
+    ("identifier", {DIGITS + LETTERS + "_": 5}, 0),
+    ("in comment", {"]": 7}, 6),
+    ("comment", {}, 0),
+    ("zero", {}, 0),
+] + [(c, {}, 0) for c in PUNCTUATION]
+
+
+def transitions(state: int) -> List[int]:
+    """Next state of every byte"""
+    _, moves, default = STATES[state]
+    targets = [default] * 256
+    for chars, target in moves.items():
+        for c in chars:
+            targets[ord(c)] = target
+    return targets
+
+
+def char_literal(b: int) -> str:
+    c = chr(b)
+    if c in "'\\":
+        return f"'\\{c}'"
+    if 32 <= b < 127:
+        return f"'{c}'"
+    return str(b)
+
+
+def cases(state: int) -> Tuple[List[Tuple[str, int]], int]:
+    """Case labels of the bytes which don't go to the default state"""
+    default = STATES[state][2]
+    targets = transitions(state)
+    labels = []
+    b = 0
+    while b < 256:
+        end = b
+        while end + 1 < 256 and targets[end + 1] == targets[b]:
+            end += 1
+        if targets[b] != default:
+            if end == b:
+                labels.append((f"case {char_literal(b)}:", targets[b]))
+            else:
+                labels.append(
+                    (f"case {char_literal(b)} ... {char_literal(end)}:", targets[b])
+                )
+        b = end + 1
+    return labels, default
+
+
+def emit_next(out: List[str]):
+    out.append("/* State after `state` consumed `c` */")
+    out.append("static inline unsigned lexer_direct_next(unsigned state, uint8_t c) {")
+    out.append("    switch (state) {")
+    for state, (name, _, _) in enumerate(STATES):
+        labels, default = cases(state)
+        if not labels and default == 0:
+            continue
+        out.append(f"        case {state}: /* {name} */")
+        out.append("            switch (c) {")
+        for label, target in labels:
+            out.append(f"                {label}")
+            out.append(f"                    return {target};")
+        out.append("                default:")
+        out.append(f"                    return {default};")
+        out.append("            }")
+    out.append("        default:")
+    out.append("            return 0;")
+    out.append("    }")
+    out.append("}")
+
+
+def emit_run(out: List[str]):
+    out.append("/*")
+    out.append(" * Run from `*state` over [p, end), stop at the end or at the first byte")
+    out.append(" * leading to the dead state, that byte is not consumed.")
+    out.append(" * Returns where the run stopped, `*state` is the state reached there.")
+    out.append(" */")
+    out.append("static inline const char *lexer_direct_run(const char *p, const char *end,")
+    out.append("                                           unsigned *state) {")
+    out.append("    switch (*state) {")
+    for state in range(len(STATES)):
+        out.append(f"        case {state}:")
+        out.append(f"            goto state_{state};")
+    out.append("        default:")
+    out.append("            goto state_0;")
+    out.append("    }")
+    out.append("state_0:")
+    out.append("    *state = 0;")
+    out.append("    return p;")
+    for state, (name, _, _) in enumerate(STATES):
+        if state == 0:
+            continue
+        labels, default = cases(state)
+        out.append(f"state_{state}: /* {name} */")
+        out.append("    if (p == end) {")
+        out.append(f"        *state = {state};")
+        out.append("        return p;")
+        out.append("    }")
+        if not labels and default == 0:
+            out.append("    *state = 0;")
+            out.append("    return p;")
+            continue
+        out.append("    switch ((uint8_t)*p++) {")
+        for label, target in labels:
+            out.append(f"        {label}")
+            out.append(f"            goto {jump(target)};")
+        out.append("        default:")
+        out.append(f"            goto {jump(default)};")
+        out.append("    }")
+    out.append("dead:")
+    out.append("    *state = 0;")
+    out.append("    return p - 1;")
+    out.append("}")
+
+
+def jump(target: int) -> str:
+    return "dead" if target == 0 else f"state_{target}"
+
+
+def main():
+    out = [
+        "/* Generated by table/lexer_gen.py, do not edit */",
+        "#ifndef MINI_COMPILER_LEXER_DIRECT_H",
+        "#define MINI_COMPILER_LEXER_DIRECT_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        f"#define LEXER_DIRECT_N_STATES {len(STATES)}",
+        "",
+    ]
+    emit_next(out)
+    out.append("")
+    emit_run(out)
+    out.append("")
+    out.append("#endif  // MINI_COMPILER_LEXER_DIRECT_H")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+#include "../arena.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../parser.h"
+#include "../source.h"
+
+// blocks are filled in order, large requests get a block of their own
+void alloc_test() {
+    Arena* arena = arena_new(256);
+    assert(arena->n_blocks == 0);
+    char* prev[64];
+    for (unsigned i = 0; i < 64; i++) {
+        prev[i] = (char*)arena_alloc(arena, i + 1);
+        assert((uintptr_t)prev[i] % alignof(max_align_t) == 0);
+        memset(prev[i], (int)i, i + 1);
+    }
+    for (unsigned i = 0; i < 64; i++) {
+        for (unsigned j = 0; j <= i; j++) {
+            assert(prev[i][j] == (char)i);
+        }
+    }
+    destroy_arena(arena);
+
+    arena = arena_new(256);
+    char* first = (char*)arena_alloc(arena, 1);
+    char* large = (char*)arena_alloc(arena, 4096);
+    memset(large, 0xff, 4096);
+    assert(arena->n_blocks == 2);
+    // the first block is still bumped after the large one
+    char* next = (char*)arena_alloc(arena, 1);
+    assert(arena->n_blocks == 2);
+    assert(next == first + alignof(max_align_t));
+    destroy_arena(arena);
+}
+
+// the heap is used again once the arena is left
+void scope_test() {
+    assert(unit_arena() == NULL);
+    Arena* arena = arena_new(0);
+    arena_enter(arena);
+    assert(unit_arena() == arena);
+    int* zeros = (int*)unit_calloc(16, sizeof(int));
+    for (unsigned i = 0; i < 16; i++) {
+        assert(zeros[i] == 0);
+    }
+    unit_free(zeros);  // no-op
+    assert(arena->allocated >= 16 * sizeof(int));
+    arena_exit();
+    assert(unit_arena() == NULL);
+    destroy_arena(arena);
+    void* p = unit_malloc(16);
+    unit_free(p);
+}
+
+/* The trace of a parse, copied out of the parser */
+SLRTrace parse_trace(const Source* src, Grammar* g, ParserState* state,
+                  size_t* n_children) {
+    // tokens, spans and lexemes of the legacy interface
+    Lexer* lexer = lexer_new_n(src->data, src->len);
+    TokenTy ty;
+    do {
+        Token* token = lexer_next_token(lexer);
+        ty = token->ty;
+        destroy_token(token);
+    } while (ty != Eof);
+    destroy_lexer(lexer);
+
+    lexer = lexer_new_n(src->data, src->len);
+    SLRParser* parser = slr_parser_init(g, &SLR_TABLE);
+    do {
+        TokenView tok = lexer_next_view(lexer);
+        if (tok.ty == Comment) {
+            *state = PARSER_IDLE;
+            continue;
+        }
+        if (tok.ty == Invalid) {
+            *state = PARSER_REJECT;
+            break;
+        }
+        *state = slr_parser_step(parser, tok);
+    } while (*state == PARSER_IDLE);
+    destroy_lexer(lexer);
+
+    // the trace is on the heap even under an arena
+    SLRTrace trace = *parser->trace;
+    trace.steps = malloc(sizeof(SLRTraceStep) * trace.size);
+    memcpy(trace.steps, parser->trace->steps,
+           sizeof(SLRTraceStep) * trace.size);
+    ParseTree* tree = slr_parser_parse_tree(parser);
+    *n_children =
+        tree->root->children == NULL ? 0 : cc_deque_size(tree->root->children);
+    destroy_parse_tree(tree);
+    destroy_slr_parser(parser);
+    return trace;
+}
+
+// parsing under an arena gives the same result as on the heap
+void parse_test(char** paths, size_t n_paths) {
+    Grammar* g = grammar_new();
+    for (size_t i = 0; i < n_paths; i++) {
+        Source* src = source_open(paths[i]);
+        assert(src != NULL);
+        ParserState heap_state, arena_state;
+        size_t heap_children, arena_children;
+        SLRTrace heap_trace = parse_trace(src, g, &heap_state, &heap_children);
+
+        Arena* arena = arena_new(0);
+        arena_enter(arena);
+        SLRTrace arena_trace =
+            parse_trace(src, g, &arena_state, &arena_children);
+        arena_exit();
+        assert(arena->n_blocks > 0);
+        destroy_arena(arena);
+
+        assert(heap_state == arena_state);
+        assert(heap_children == arena_children);
+        assert(heap_trace.size == arena_trace.size);
+        assert(memcmp(heap_trace.steps, arena_trace.steps,
+                      sizeof(SLRTraceStep) * heap_trace.size) == 0);
+        free(heap_trace.steps);
+        free(arena_trace.steps);
+        destroy_source(src);
+    }
+    destroy_grammar(g);
+}
+
+int main(int argc, char** argv) {
+    alloc_test();
+    scope_test();
+    // the remaining arguments are source files
+    parse_test(argv + 1, argc - 1);
+}
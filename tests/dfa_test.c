@@ -1,16 +1,60 @@
 #include <assert.h>
+#include <string.h>
 
 #include "../lexer.h"
 
+TokenTy kind_of(const DFA* dfa, const char* s) {
+    DFACursor cursor = dfa_cursor(dfa);
+    for (const char* p = s; *p != '\0'; p++) {
+        dfa_next(&cursor, *p);
+    }
+    return dfa_token_kind(&cursor, s, strlen(s));
+}
+
 int main() {
-    DFA* dfa = &LEXER_DFA;
+    const DFA* dfa = &LEXER_DFA;
 
     // should pass
     assert(dfa_matches(dfa, "abc"));
     assert(dfa_matches(dfa, "0"));
+    assert(dfa_matches(dfa, "120"));
+    assert(dfa_matches(dfa, "a_1"));
+    assert(dfa_matches(dfa, "->"));
+    assert(dfa_matches(dfa, "[ comment ]"));
+    assert(dfa_matches(dfa, ";"));
 
     // should fail
     assert(!dfa_matches(dfa, "00"));
     assert(!dfa_matches(dfa, "0 "));
+    assert(!dfa_matches(dfa, "-"));
+    assert(!dfa_matches(dfa, "[ comment"));
+    assert(!dfa_matches(dfa, "_"));
+    assert(!dfa_matches(dfa, "\xff"));
+
+    // token kinds come straight from the accept states
+    assert(kind_of(dfa, "fun") == FuncDecl);
+    assert(kind_of(dfa, "bool") == BoolDecl);
+    assert(kind_of(dfa, "nat") == NatDecl);
+    assert(kind_of(dfa, "T") == Literal);
+    assert(kind_of(dfa, "F") == Literal);
+    assert(kind_of(dfa, "0") == Literal);
+    assert(kind_of(dfa, "42") == Literal);
+    assert(kind_of(dfa, "funny") == Identifier);
+    assert(kind_of(dfa, "na") == Identifier);
+    assert(kind_of(dfa, "Fa") == Identifier);
+    assert(kind_of(dfa, "boo1") == Identifier);
+    assert(kind_of(dfa, "->") == Arrow);
+    assert(kind_of(dfa, "[]") == Comment);
+    assert(kind_of(dfa, "?") == QuestionMark);
+    assert(kind_of(dfa, ":") == Colon);
+    assert(kind_of(dfa, ";") == Semicolon);
+    assert(kind_of(dfa, "(") == LeftParen);
+    assert(kind_of(dfa, ")") == RightParen);
+    assert(kind_of(dfa, "+") == Plus);
+    assert(kind_of(dfa, "&") == Ampersand);
+    assert(kind_of(dfa, "<") == Less);
+    assert(kind_of(dfa, "=") == Equal);
+    assert(kind_of(dfa, "-") == Invalid);
+    assert(kind_of(dfa, "01") == Invalid);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,44 @@
+#include "../interner.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// ids are dense and stable, names survive the growth of the arena
+void fuzzy_test() {
+    Interner* names = interner_new();
+    char buf[64];
+    for (unsigned i = 0; i < 10000; i++) {
+        snprintf(buf, sizeof(buf), "name%u", i);
+        assert(interner_intern(names, buf, strlen(buf)) == i);
+    }
+    assert(names->size == 10000);
+    for (unsigned i = 0; i < 10000; i++) {
+        snprintf(buf, sizeof(buf), "name%u", i);
+        assert(interner_intern(names, buf, strlen(buf)) == i);
+        assert(interner_find(names, buf, strlen(buf)) == i);
+        assert(strcmp(interner_name(names, i), buf) == 0);
+        assert(interner_len(names, i) == strlen(buf));
+    }
+    assert(names->size == 10000);
+    destroy_interner(names);
+}
+
+// names are compared by their bytes, not as c strings
+void prefix_test() {
+    Interner* names = interner_new();
+    const char* s = "abcabc";
+    SymbolId abc = interner_intern(names, s, 3);
+    SymbolId ab = interner_intern(names, s, 2);
+    SymbolId empty = interner_intern(names, s, 0);
+    assert(abc != ab && ab != empty && abc != empty);
+    assert(interner_intern(names, s + 3, 3) == abc);
+    assert(interner_find(names, "abca", 4) == SYMBOL_NONE);
+    assert(strcmp(interner_name(names, empty), "") == 0);
+    destroy_interner(names);
+}
+
+int main() {
+    fuzzy_test();
+    prefix_test();
+}
@@ -1,5 +1,7 @@
 #include "../lexer.h"
 
+#include <assert.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,4 +35,587 @@ void parse(char* s) {
     free(mut);
 }
 
-int main() { parse("abc   def   func  1234   a"); }
\ No newline at end of file
+// the borrowed views should agree with the owned tokens
+void view_test(const char* s) {
+    Lexer* owned = lexer_new(s);
+    Lexer* borrowed = lexer_new(s);
+    LineIndex* lines = line_index_new(s, strlen(s));
+    while (true) {
+        Token* token = lexer_next_token(owned);
+        TokenView view = lexer_next_view(borrowed);
+        char token_buf[256];
+        char view_buf[256];
+        debug_token(token, token_buf, sizeof(token_buf));
+        debug_token_view(borrowed, view, view_buf, sizeof(view_buf));
+        assert(strcmp(token_buf, view_buf) == 0);
+        assert(token->ty == view.ty);
+        assert(token->span->start == view.start);
+        unsigned line, column;
+        token_view_position(lines, view, &line, &column);
+        assert(token->span->line == line);
+        assert(token->span->column == column);
+        destroy_token(token);
+        if (view.ty == Eof) {
+            break;
+        }
+        assert(strncmp(s + view.start, lexer_lexeme(borrowed, view),
+                       view.len) == 0);
+    }
+    destroy_lexer(owned);
+    destroy_lexer(borrowed);
+    destroy_line_index(lines);
+}
+
+// the token buffer should hold exactly the stream of views
+void tokenize_all_test(const char* s) {
+    Lexer* lexer = lexer_new(s);
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    lexer = lexer_new(s);
+    for (size_t i = 0; i < tokens->size; i++) {
+        TokenView expected = lexer_next_view(lexer);
+        TokenView actual = token_buffer_get(tokens, i);
+        assert(memcmp(&expected, &actual, sizeof(TokenView)) == 0);
+    }
+    assert(tokens->ty[tokens->size - 1] == Eof);
+    destroy_lexer(lexer);
+    destroy_token_buffer(tokens);
+}
+
+// every set of fast path kernels should produce the same stream
+void simd_test(const char* s) {
+    LexerSimd levels[] = {LEXER_SIMD_SCALAR, LEXER_SIMD_SSE2, LEXER_SIMD_AVX2};
+    LexerSimd origin = lexer_get_simd();
+    lexer_set_simd(LEXER_SIMD_OFF);
+    Lexer* lexer = lexer_new(s);
+    TokenBuffer* expected = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        lexer_set_simd(levels[i]);
+        lexer = lexer_new(s);
+        TokenBuffer* actual = lexer_tokenize_all(lexer);
+        assert(actual->size == expected->size);
+        for (size_t j = 0; j < actual->size; j++) {
+            TokenView l = token_buffer_get(expected, j);
+            TokenView r = token_buffer_get(actual, j);
+            assert(memcmp(&l, &r, sizeof(TokenView)) == 0);
+        }
+        destroy_token_buffer(actual);
+        destroy_lexer(lexer);
+    }
+    destroy_token_buffer(expected);
+    lexer_set_simd(origin);
+}
+
+/* The streaming lexer must agree with the in-memory one for any buffer size */
+void stream_test(const char* s) {
+    Lexer* lexer = lexer_new(s);
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+    LineIndex* lines = line_index_new(s, strlen(s));
+
+    size_t capacities[] = {8, 13, 64, 0};
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        FILE* file = tmpfile();
+        fputs(s, file);
+        rewind(file);
+        StreamLexer* stream = c % 2 == 0
+                                  ? stream_lexer_new_file(file, capacities[c])
+                                  : stream_lexer_new_fd(fileno(file),
+                                                        capacities[c]);
+        for (size_t i = 0; i < tokens->size; i++) {
+            TokenView expected = token_buffer_get(tokens, i);
+            StreamToken actual = stream_lexer_next_token(stream);
+            assert(actual.ty == expected.ty);
+            assert(actual.start == expected.start);
+            assert(actual.len == expected.len);
+            unsigned line, column;
+            token_view_position(lines, expected, &line, &column);
+            assert(actual.line == line);
+            assert(actual.column == column);
+            if (actual.ty != Eof && actual.len <= stream->capacity) {
+                assert(memcmp(actual.lexeme, s + expected.start,
+                              expected.len) == 0);
+            } else {
+                assert(actual.lexeme == NULL);
+            }
+        }
+        assert(stream_lexer_next_token(stream).ty == Eof);
+        destroy_stream_lexer(stream);
+        fclose(file);
+    }
+    destroy_token_buffer(tokens);
+    destroy_line_index(lines);
+}
+
+/* Chunked parallel lexing must be indistinguishable from sequential lexing */
+void parallel_test(const char* s) {
+    Interner* names = interner_new();
+    Lexer* lexer = lexer_new(s);
+    lexer->interner = names;
+    TokenBuffer* expected = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    // (threads, chunk size), the ids are given in source order either way
+    unsigned configs[][2] = {{4, 1}, {4, 7}, {2, 16}, {4, 1000}, {1, 1}};
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        Interner* fresh = interner_new();
+        TokenBuffer* actual = lexer_tokenize_parallel(
+            s, strlen(s), configs[c][0], configs[c][1], fresh);
+        assert(actual->size == expected->size);
+        for (size_t i = 0; i < expected->size; i++) {
+            TokenView l = token_buffer_get(expected, i);
+            TokenView r = token_buffer_get(actual, i);
+            assert(memcmp(&l, &r, sizeof(TokenView)) == 0);
+        }
+        assert(fresh->size == names->size);
+        destroy_token_buffer(actual);
+        destroy_interner(fresh);
+    }
+    destroy_token_buffer(expected);
+    destroy_interner(names);
+}
+
+// identifiers are interned while they are lexed, nothing else is
+void intern_test() {
+    Interner* names = interner_new();
+    Lexer* lexer = lexer_new("fun f nat x -> f x; g x [x] 0");
+    lexer->interner = names;
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    assert(tokens->interner == names);
+    assert(names->size == 3);
+    SymbolId* ids = tokens->symbol;
+    assert(ids[1] == ids[5] && ids[3] == ids[6] && ids[6] == ids[9]);
+    assert(ids[1] != ids[3] && ids[3] != ids[8] && ids[1] != ids[8]);
+    assert(strcmp(interner_name(names, ids[8]), "g") == 0);
+    assert(interner_find(names, "x", 1) == ids[3]);
+    SymbolId none[] = {0, 2, 4, 7, 10, 11, 12};
+    for (size_t i = 0; i < sizeof(none) / sizeof(none[0]); i++) {
+        assert(ids[none[i]] == SYMBOL_NONE);
+    }
+    assert(tokens->ty[12] == Eof);
+    destroy_token_buffer(tokens);
+    destroy_interner(names);
+}
+
+void assert_same_tokens(const TokenBuffer* l, const TokenBuffer* r) {
+    assert(l->size == r->size);
+    for (size_t i = 0; i < l->size; i++) {
+        TokenView lt = token_buffer_get(l, i);
+        TokenView rt = token_buffer_get(r, i);
+        assert(memcmp(&lt, &rt, sizeof(TokenView)) == 0);
+    }
+}
+
+/* Random edits, re-lexing must agree with lexing the edited source */
+void relex_test(const char* s, bool skip_comments) {
+    const char* pieces[] = {"",  "x", " ",  "\n",   "[",  "]",
+                            "-", ">", "12", "fun ", "0;", "[ a\n b ]"};
+    size_t n_pieces = sizeof(pieces) / sizeof(pieces[0]);
+    char* src = mutable_str((char*)s);
+    size_t len = strlen(src);
+    Interner* names = interner_new();
+    Lexer* lexer = lexer_new(src);
+    lexer->interner = names;
+    lexer_skip_comments(lexer, skip_comments);
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    unsigned seed = 7;
+    for (int round = 0; round < 500; round++) {
+        seed = seed * 1103515245 + 12345;
+        LexEdit edit;
+        edit.offset = (seed >> 8) % (len + 1);
+        edit.deleted = (seed >> 4) % 4;
+        if (edit.deleted > len - edit.offset) {
+            edit.deleted = len - edit.offset;
+        }
+        const char* piece = pieces[(seed >> 16) % n_pieces];
+        edit.inserted = strlen(piece);
+
+        size_t edited_len = len - edit.deleted + edit.inserted;
+        char* edited = (char*)malloc(edited_len + 1);
+        memcpy(edited, src, edit.offset);
+        memcpy(edited + edit.offset, piece, edit.inserted);
+        strcpy(edited + edit.offset + edit.inserted,
+               src + edit.offset + edit.deleted);
+        free(src);
+        src = edited;
+        len = edited_len;
+
+        lexer_relex(tokens, src, len, edit);
+        lexer = lexer_new(src);
+        lexer->interner = names;
+        lexer_skip_comments(lexer, skip_comments);
+        TokenBuffer* expected = lexer_tokenize_all(lexer);
+        destroy_lexer(lexer);
+        assert_same_tokens(expected, tokens);
+        destroy_token_buffer(expected);
+    }
+    destroy_token_buffer(tokens);
+    destroy_interner(names);
+    free(src);
+}
+
+/* A small edit in a large source only re-lexes the tokens around it */
+void relex_locality_test() {
+    const char* line = "fun f nat x -> x + 1; [ comment ]\n";
+    size_t line_len = strlen(line);
+    size_t len = line_len * 1000;
+    char* src = (char*)malloc(len + 2);
+    for (size_t i = 0; i < 1000; i++) {
+        memcpy(src + i * line_len, line, line_len);
+    }
+    src[len] = '\0';
+    Lexer* lexer = lexer_new(src);
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    // "x + 1" -> "xy + 1" in the middle of the source
+    unsigned offset = line_len * 500 + 15;
+    memmove(src + offset + 1, src + offset, len - offset + 1);
+    src[offset] = 'y';
+    LexEdit edit = {.offset = offset, .deleted = 0, .inserted = 1};
+    assert(lexer_relex(tokens, src, len + 1, edit) <= 2);
+
+    lexer = lexer_new(src);
+    TokenBuffer* expected = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+    assert_same_tokens(expected, tokens);
+    destroy_token_buffer(expected);
+    destroy_token_buffer(tokens);
+    free(src);
+}
+
+// comment bodies must be valid UTF-8, anything else is an invalid token
+void utf8_test() {
+    struct {
+        const char* body;
+        bool valid;
+    } cases[] = {
+        {"plain ascii, long enough for a couple of words", true},
+        {"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80", true},
+        {"\xed\x9f\xbf \xf4\x8f\xbf\xbf", true}, /* U+D7FF U+10FFFF */
+        {"\xc0\x80", false},                     /* overlong */
+        {"\xe0\x9f\xbf", false},                 /* overlong */
+        {"\xed\xa0\x80", false},                 /* surrogate */
+        {"\xf4\x90\x80\x80", false},             /* past U+10FFFF */
+        {"\xf5\x80\x80\x80", false},
+        {"0123456789abcdef\x80", false}, /* lone continuation */
+        {"ab\xe2\x82", false},            /* cut by the bracket */
+        /* past the first vector of the comment kernels */
+        {"0123456789abcdef0123456789abcdef012\xe2\x82\xac 0123456789abcdef",
+         true},
+        {"0123456789abcdef0123456789abcdef012\xe2\x82 0123456789abcdef",
+         false},
+    };
+    LexerSimd origin = lexer_get_simd();
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char s[128];
+        snprintf(s, sizeof(s), "x [%s] y", cases[i].body);
+        for (LexerSimd simd = LEXER_SIMD_OFF; simd <= LEXER_SIMD_AVX2;
+             simd++) {
+            lexer_set_simd(simd);
+            Lexer* lexer = lexer_new(s);
+            lexer_skip_comments(lexer, true);
+            TokenView x = lexer_next_view(lexer);
+            TokenView comment = lexer_next_view(lexer);
+            assert(x.ty == Identifier);
+            if (cases[i].valid) {
+                // skipped, this is `y`
+                assert(comment.ty == Identifier);
+                assert(comment.start == strlen(cases[i].body) + 5);
+            } else {
+                // never skipped
+                assert(comment.ty == Invalid);
+                assert(comment.start == 2);
+                assert(comment.len == strlen(cases[i].body) + 2);
+            }
+            destroy_lexer(lexer);
+        }
+        lexer_set_simd(origin);
+        stream_test(s);
+        parallel_test(s);
+    }
+}
+
+// a slice of a bigger buffer is lexed without looking past its end
+void slice_test() {
+    const char* texts[] = {
+        "fun f nat x -> x + 1; x-->[c]0 12 ab",
+        "a-->b - >c->d == e = = f -",
+        "x\xc3\xa9y \x80 [caf\xc3\xa9] \xff-\xfe> 1",
+        /* an arrow across the stream, SSE2 and AVX2 chunks */
+        "abcdefg->12345 ->abcdefghijklmn-> x",
+    };
+    LexerSimd origin = lexer_get_simd();
+    for (size_t t = 0; t < sizeof(texts) / sizeof(texts[0]); t++) {
+        size_t n = strlen(texts[t]);
+        for (size_t len = 0; len <= n; len++) {
+            char* terminated = (char*)malloc(len + 1);
+            memcpy(terminated, texts[t], len);
+            terminated[len] = '\0';
+            // every level must match the DFA loop
+            lexer_set_simd(LEXER_SIMD_OFF);
+            Lexer* lexer = lexer_new(terminated);
+            TokenBuffer* expected = lexer_tokenize_all(lexer);
+            destroy_lexer(lexer);
+
+            for (LexerSimd simd = LEXER_SIMD_OFF; simd <= LEXER_SIMD_AVX2;
+                 simd++) {
+                lexer_set_simd(simd);
+                lexer = lexer_new_n(texts[t], len);
+                TokenBuffer* tokens = lexer_tokenize_all(lexer);
+                destroy_lexer(lexer);
+                assert_same_tokens(tokens, expected);
+                destroy_token_buffer(tokens);
+
+                // exactly `len` bytes, for the sanitizer to catch overreads
+                char* exact = (char*)malloc(len);
+                memcpy(exact, texts[t], len);
+                lexer = lexer_new_n(exact, len);
+                tokens = lexer_tokenize_all(lexer);
+                destroy_lexer(lexer);
+                assert_same_tokens(tokens, expected);
+                destroy_token_buffer(tokens);
+                free(exact);
+
+                lexer = lexer_new(terminated);
+                tokens = lexer_tokenize_all(lexer);
+                destroy_lexer(lexer);
+                assert_same_tokens(tokens, expected);
+                destroy_token_buffer(tokens);
+            }
+            destroy_token_buffer(expected);
+            free(terminated);
+        }
+        for (LexerSimd simd = LEXER_SIMD_OFF; simd <= LEXER_SIMD_AVX2;
+             simd++) {
+            lexer_set_simd(simd);
+            stream_test(texts[t]);
+        }
+    }
+    lexer_set_simd(origin);
+}
+
+typedef struct CommentRanges {
+    unsigned start[16];
+    unsigned len[16];
+    size_t size;
+} CommentRanges;
+
+void record_comment(void* ctx, unsigned start, unsigned len) {
+    CommentRanges* ranges = (CommentRanges*)ctx;
+    assert(ranges->size < 16);
+    ranges->start[ranges->size] = start;
+    ranges->len[ranges->size] = len;
+    ranges->size++;
+}
+
+// skipped comments are the comment tokens, reported through the callback
+void skip_comments_test(const char* s) {
+    Lexer* lexer = lexer_new(s);
+    TokenBuffer* all = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    CommentRanges ranges = {.size = 0};
+    lexer = lexer_new(s);
+    lexer_skip_comments(lexer, true);
+    lexer_on_comment(lexer, record_comment, &ranges);
+    TokenBuffer* skipped = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    size_t j = 0;
+    size_t k = 0;
+    for (size_t i = 0; i < all->size; i++) {
+        TokenView token = token_buffer_get(all, i);
+        if (token.ty == Comment) {
+            assert(k < ranges.size);
+            assert(ranges.start[k] == token.start);
+            assert(ranges.len[k] == token.len);
+            k++;
+        } else {
+            TokenView other = token_buffer_get(skipped, j++);
+            assert(memcmp(&token, &other, sizeof(TokenView)) == 0);
+        }
+    }
+    assert(j == skipped->size);
+    assert(k == ranges.size);
+    destroy_token_buffer(all);
+    destroy_token_buffer(skipped);
+
+    // neither are there owned comment tokens
+    lexer = lexer_new(s);
+    lexer_skip_comments(lexer, true);
+    TokenTy ty;
+    do {
+        Token* token = lexer_next_token(lexer);
+        ty = token->ty;
+        destroy_token(token);
+        assert(ty != Comment);
+    } while (ty != Eof);
+    destroy_lexer(lexer);
+}
+
+// the comment handling of a buffer is kept when it is lexed again
+void relex_skip_comments_test() {
+    const char* before = "fun f nat x -> x + 1 ; 2";
+    const char* after = "fun f nat x -> x [c] + 1 ; 2";
+    CommentRanges ranges = {.size = 0};
+    Lexer* lexer = lexer_new(before);
+    lexer_skip_comments(lexer, true);
+    lexer_on_comment(lexer, record_comment, &ranges);
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+
+    LexEdit edit = {.offset = 17, .deleted = 0, .inserted = 4};
+    lexer_relex(tokens, after, strlen(after), edit);
+    assert(ranges.size == 1);
+    assert(ranges.start[0] == 17 && ranges.len[0] == 3);
+
+    lexer = lexer_new(after);
+    lexer_skip_comments(lexer, true);
+    TokenBuffer* expected = lexer_tokenize_all(lexer);
+    destroy_lexer(lexer);
+    assert_same_tokens(expected, tokens);
+    destroy_token_buffer(expected);
+    destroy_token_buffer(tokens);
+}
+
+typedef struct LexJob {
+    char** sources;
+    TokenBuffer** expected;
+    size_t n;
+    size_t first; /* index of the source the job starts at */
+} LexJob;
+
+/* Next token of a lexer, compared with the sequential one */
+static bool check_next(Lexer* lexer, const TokenBuffer* expected, size_t* i) {
+    TokenView actual = lexer_next_view(lexer);
+    TokenView token = token_buffer_get(expected, (*i)++);
+    assert(memcmp(&actual, &token, sizeof(TokenView)) == 0);
+    return actual.ty == Eof;
+}
+
+/* Lex every source, two lexers at a time interleaved token by token */
+static void* lex_job(void* arg) {
+    LexJob* job = (LexJob*)arg;
+    for (size_t k = 0; k < job->n; k++) {
+        size_t a = (job->first + k) % job->n;
+        size_t b = (job->first + k + 1) % job->n;
+        Lexer* la = lexer_new(job->sources[a]);
+        Lexer* lb = lexer_new(job->sources[b]);
+        size_t ia = 0;
+        size_t ib = 0;
+        bool done_a = false;
+        bool done_b = false;
+        while (!done_a || !done_b) {
+            done_a = done_a || check_next(la, job->expected[a], &ia);
+            done_b = done_b || check_next(lb, job->expected[b], &ib);
+        }
+        destroy_lexer(la);
+        destroy_lexer(lb);
+    }
+    return NULL;
+}
+
+char* slurp(const char* path) {
+    FILE* file = fopen(path, "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    rewind(file);
+    char* src = (char*)malloc(len + 1);
+    assert(fread(src, 1, len, file) == (size_t)len);
+    src[len] = '\0';
+    fclose(file);
+    return src;
+}
+
+/* Many lexers on many threads must agree with lexing one file at a time */
+void threads_test(char** paths, size_t n_paths) {
+    const char* builtin[] = {
+        "[a comment\n spanning lines] fun f nat x->T?x+1:0;\n (f 00 @ 12)\n",
+        "fun x [ an unterminated comment\n with lines",
+        "",
+    };
+    size_t n_builtin = sizeof(builtin) / sizeof(builtin[0]);
+    size_t n = n_builtin + n_paths;
+    char** sources = (char**)malloc(sizeof(char*) * n);
+    TokenBuffer** expected = (TokenBuffer**)malloc(sizeof(TokenBuffer*) * n);
+    for (size_t i = 0; i < n; i++) {
+        sources[i] = i < n_builtin ? mutable_str((char*)builtin[i])
+                                   : slurp(paths[i - n_builtin]);
+        Lexer* lexer = lexer_new(sources[i]);
+        expected[i] = lexer_tokenize_all(lexer);
+        destroy_lexer(lexer);
+    }
+
+    LexerSimd origin = lexer_get_simd();
+    LexerSimd levels[] = {LEXER_SIMD_OFF, origin};
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        lexer_set_simd(levels[l]);
+        pthread_t threads[8];
+        LexJob jobs[8];
+        for (size_t t = 0; t < 8; t++) {
+            jobs[t] = (LexJob){sources, expected, n, t * n / 8};
+            assert(pthread_create(&threads[t], NULL, lex_job, &jobs[t]) == 0);
+        }
+        for (size_t t = 0; t < 8; t++) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    lexer_set_simd(origin);
+
+    for (size_t i = 0; i < n; i++) {
+        free(sources[i]);
+        destroy_token_buffer(expected[i]);
+    }
+    free(sources);
+    free(expected);
+}
+
+int main(int argc, char** argv) {
+    parse("abc   def   func  1234   a");
+    tokenize_all_test("[comment] fun f nat x -> T ? x + 1 : 0;\n (f 00 @ 12)");
+    simd_test(
+        "fun aVeryLongIdentifierName0123456789abcdefghij nat x ->\n"
+        "   \t\n\n                                      \v\f\r\n  "
+        "(f 1234567890123456789012345678901234567890 01234567890123456789)"
+        "[ a comment which is longer than thirty two bytes \n for sure ]"
+        "[ unterminated comment which is also longer than thirty two bytes");
+    view_test("[comment] fun f nat x -> T ? x + 1 : 0;\n (f 00 @ 12)");
+    stream_test(
+        "[a comment spanning\n chunks] fun f nat x->T?x+1:0;\n (f 00 @ 12) "
+        "aVeryLongIdentifierName 12345678901234567890 - -> ->x bool\t\n ");
+    stream_test("fun x [ an unterminated comment spanning chunks");
+    stream_test("");
+    parallel_test(
+        "[a comment\n spanning lines] fun f nat x->T?x+1:0;\n (f 00 @ 12)\n"
+        "  \n\tfun g bool b -> b & T; [ another\n one ]   x\n\n-\n>->");
+    parallel_test("fun x [ an unterminated comment\n with lines");
+    parallel_test("   \n  ");
+    parallel_test("");
+    const char* relexed =
+        "[a comment\n spanning lines] fun f nat x->T?x+1:0;\n (f 00 @ 12)\n"
+        "  \n\tfun g bool b -> b & T; [ another\n one ]   x\n\n-\n>->";
+    relex_test(relexed, false);
+    relex_test(relexed, true);
+    relex_test("", false);
+    relex_test("", true);
+    relex_skip_comments_test();
+    relex_locality_test();
+    intern_test();
+    skip_comments_test(
+        "[a comment\n spanning lines] fun f nat x->T?x+1:0;\n [][x] (f 00 @ "
+        "12)[]\n [ another\n one ]x");
+    skip_comments_test("[ first ] fun x [ an unterminated comment\n with lines");
+    skip_comments_test("");
+    slice_test();
+    utf8_test();
+    // the remaining arguments are source files
+    threads_test(argv + 1, argc - 1);
+}
\ No newline at end of file
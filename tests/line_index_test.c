@@ -0,0 +1,60 @@
+#include "../line_index.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the simd counts agree with a byte by byte count, at any alignment and
+// across the points where the lane counters are summed
+void newline_count_test() {
+    size_t len = 20000;
+    char *buf = (char *)malloc(len);
+    memset(buf, '\n', len);
+    assert(newline_count(buf, len) == len);
+    unsigned seed = 3;
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (seed >> 16) % 3 == 0 ? '\n' : 'a';
+    }
+    for (size_t from = 0; from < 40; from++) {
+        for (size_t to = len - 40; to <= len; to += 3) {
+            size_t expected = 0;
+            for (size_t i = from; i < to; i++) {
+                expected += buf[i] == '\n';
+            }
+            assert(newline_count(buf + from, to - from) == expected);
+        }
+    }
+    free(buf);
+}
+
+// positions agree with walking the source from the start
+void lookup_test(const char *s) {
+    unsigned len = strlen(s);
+    LineIndex *index = line_index_new(s, len);
+    assert(index->n_lines == 0);
+    unsigned expected_line = 1;
+    unsigned expected_column = 1;
+    for (unsigned offset = 0; offset <= len + 2; offset++) {
+        unsigned line, column;
+        line_index_lookup(index, offset, &line, &column);
+        assert(line == expected_line);
+        assert(column == expected_column);
+        if (offset < len && s[offset] == '\n') {
+            expected_line += 1;
+            expected_column = 1;
+        } else {
+            expected_column += 1;
+        }
+    }
+    destroy_line_index(index);
+}
+
+int main() {
+    newline_count_test();
+    lookup_test("");
+    lookup_test("\n");
+    lookup_test("\n\n");
+    lookup_test("fun f nat x ->\n\tx + 1;\n[ a comment\n on lines ]\r\n  x");
+    lookup_test("no newline at all");
+}
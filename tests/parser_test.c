@@ -2,47 +2,17 @@
 
 #include <stdio.h>
 
-char* read_file(char* path) {
-    FILE* file = fopen(path, "r");
-
-    if (file == NULL) {
-        printf("Fail to open %s\n", path);
-        return NULL;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char* buffer = (char*)malloc(file_size + 1);
-
-    if (buffer == NULL) {
-        fclose(file);
-        printf("Memory not enough\n");
-        return NULL;
-    }
-
-    fread(buffer, file_size, 1, file);
-    buffer[file_size] = '\0';
-
-    fclose(file);
-
-    return buffer;
-}
+#include "../source.h"
 
 // check whether the given src satisfied the expectation
-bool check_src(char* src, Grammar* g, bool expected_pass) {
-    Lexer* lexer = lexer_new(src);
+bool check_src(const Source* src, Grammar* g, bool expected_pass) {
+    Lexer* lexer = lexer_new_n(src->data, src->len);
+    lexer_skip_comments(lexer, true);
     SLRParser* parser = slr_parser_init(g, &SLR_TABLE);
     ParserState state;
     do {
-        Token* tok = lexer_next_token(lexer);
-        if (tok->ty == Comment) {
-            destroy_token(tok);
-            continue;
-        }
-        if (tok->ty == Invalid) {
-            destroy_token(tok);
+        TokenView tok = lexer_next_view(lexer);
+        if (tok.ty == Invalid) {
             state = PARSER_REJECT;
             break;
         }
@@ -54,6 +24,19 @@ bool check_src(char* src, Grammar* g, bool expected_pass) {
     destroy_parse_tree(tree);
     destroy_slr_parser(parser);
     destroy_lexer(lexer);
+
+    // the batch interface should agree with the step-by-step one
+    lexer = lexer_new_n(src->data, src->len);
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    parser = slr_parser_init(g, &SLR_TABLE);
+    bool buffer_check = slr_parser_parse_buffer(parser, tokens, NULL) == state;
+    destroy_slr_parser(parser);
+    destroy_token_buffer(tokens);
+    destroy_lexer(lexer);
+    if (!buffer_check) {
+        return false;
+    }
+
     switch (expected_pass) {
         case true:
             return state == PARSER_ACCEPT && tree_check;
@@ -72,7 +55,12 @@ int main(int argc, char* argv[]) {
         bool expected_pass;
         printf("Testing %s => ", path);
         fflush(stdout);
-        char* src = read_file(argv[i]);
+        Source* src = source_open(argv[i]);
+        if (src == NULL) {
+            printf("Fail to open %s\n", path);
+            ret_code |= 1;
+            break;
+        }
         // pass
         if (strstr(path, "pass") != NULL) {
             expected_pass = true;
@@ -84,6 +72,7 @@ int main(int argc, char* argv[]) {
             printf(
                 "Invalid File Name, Must Suffix with \"pass\" or \"fail\"\n");
             ret_code |= 1;
+            destroy_source(src);
             break;
         }
 
@@ -94,7 +83,7 @@ int main(int argc, char* argv[]) {
             printf("[fail]\n");
             ret_code |= 1;
         }
-        free(src);
+        destroy_source(src);
     }
     destroy_grammar(g);
     return ret_code;
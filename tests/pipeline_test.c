@@ -0,0 +1,171 @@
+#include "../pipeline.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../source.h"
+
+#define N_TOKENS 100000
+
+// linked with --wrap=pthread_create, to run out of threads on demand
+static bool no_threads = false;
+
+int __real_pthread_create(pthread_t* thread, const pthread_attr_t* attr,
+                          void* (*start)(void*), void* arg);
+
+int __wrap_pthread_create(pthread_t* thread, const pthread_attr_t* attr,
+                          void* (*start)(void*), void* arg) {
+    if (no_threads) {
+        return EAGAIN;
+    }
+    return __real_pthread_create(thread, attr, start, arg);
+}
+
+static void* produce_sequence(void* arg) {
+    TokenRing* ring = (TokenRing*)arg;
+    TokenView batch[13];
+    unsigned next = 0;
+    for (size_t size = 1; next < N_TOKENS; size = size % 13 + 1) {
+        size_t n = 0;
+        for (; n < size && next < N_TOKENS; n++) {
+            batch[n] = (TokenView){.start = next++, .ty = Identifier};
+        }
+        assert(token_ring_push(ring, batch, n) == n);
+    }
+    token_ring_close(ring);
+    return NULL;
+}
+
+// tokens come out in order across wrap-arounds, whatever the batch sizes
+void ring_test() {
+    TokenRing* ring = token_ring_new(5);
+    assert(ring->mask == 7);
+    pthread_t producer;
+    assert(pthread_create(&producer, NULL, produce_sequence, ring) == 0);
+    TokenView out[11];
+    unsigned expected = 0;
+    size_t n;
+    for (size_t max = 1; (n = token_ring_pop(ring, out, max)) > 0;
+         max = max % 11 + 1) {
+        assert(n <= max);
+        for (size_t i = 0; i < n; i++) {
+            assert(out[i].start == expected++);
+        }
+    }
+    assert(expected == N_TOKENS);
+    pthread_join(producer, NULL);
+    destroy_token_ring(ring);
+}
+
+typedef struct BlockedPush {
+    TokenRing* ring;
+    size_t pushed;
+} BlockedPush;
+
+static void* push_until_closed(void* arg) {
+    BlockedPush* job = (BlockedPush*)arg;
+    TokenView tokens[16] = {0};
+    job->pushed = token_ring_push(job->ring, tokens, 16);
+    return NULL;
+}
+
+// a producer waiting for room returns once the consumer closes the ring
+void close_test() {
+    TokenRing* ring = token_ring_new(4);
+    BlockedPush job = {.ring = ring};
+    pthread_t producer;
+    assert(pthread_create(&producer, NULL, push_until_closed, &job) == 0);
+    TokenView out[2];
+    assert(token_ring_pop(ring, out, 2) == 2);
+    token_ring_close(ring);
+    pthread_join(producer, NULL);
+    assert(job.pushed >= 4 && job.pushed <= 6);
+    // what was pushed before the close is still delivered
+    size_t drained = 0, n;
+    while ((n = token_ring_pop(ring, out, 2)) > 0) {
+        drained += n;
+    }
+    assert(drained == job.pushed - 2);
+    destroy_token_ring(ring);
+}
+
+/* A copy of the trace of a parser */
+SLRTrace copy_trace(SLRParser* parser) {
+    SLRTrace trace = *parser->trace;
+    trace.steps = malloc(sizeof(SLRTraceStep) * trace.size);
+    memcpy(trace.steps, parser->trace->steps,
+           sizeof(SLRTraceStep) * trace.size);
+    return trace;
+}
+
+// the pipeline parses like the buffer driver, with any ring and batch size
+// and without a lexer thread
+void parse_test(char** paths, size_t n_paths) {
+    Grammar* g = grammar_new();
+    size_t configs[][2] = {{1, 1}, {8, 3}, {64, 100}, {0, 0}};
+    size_t n_configs = sizeof(configs) / sizeof(configs[0]);
+    for (size_t i = 0; i < n_paths; i++) {
+        Source* src = source_open(paths[i]);
+        assert(src != NULL);
+        Lexer* lexer = lexer_new_n(src->data, src->len);
+        TokenBuffer* tokens = lexer_tokenize_all(lexer);
+        SLRParser* parser = slr_parser_init(g, &SLR_TABLE);
+        size_t pos;
+        ParserState expected = slr_parser_parse_buffer(parser, tokens, &pos);
+        TokenView expected_last = token_buffer_get(tokens, pos);
+        SLRTrace expected_trace = copy_trace(parser);
+        destroy_slr_parser(parser);
+        destroy_token_buffer(tokens);
+        destroy_lexer(lexer);
+
+        for (size_t c = 0; c <= n_configs; c++) {
+            // the last run falls back to the calling thread
+            no_threads = c == n_configs;
+            size_t capacity = no_threads ? 0 : configs[c][0];
+            size_t batch = no_threads ? 0 : configs[c][1];
+            parser = slr_parser_init(g, &SLR_TABLE);
+            TokenView last;
+            ParserState state = slr_parser_parse_pipelined(
+                parser, src->data, src->len, NULL, capacity, batch, &last);
+            assert(state == expected);
+            assert(last.ty == expected_last.ty);
+            assert(last.start == expected_last.start);
+            const SLRTrace* trace = parser->trace;
+            assert(trace->size == expected_trace.size);
+            assert(memcmp(trace->steps, expected_trace.steps,
+                          sizeof(SLRTraceStep) * trace->size) == 0);
+            destroy_slr_parser(parser);
+        }
+        no_threads = false;
+        free(expected_trace.steps);
+        destroy_source(src);
+    }
+
+    // an invalid token stops both threads early
+    const char* invalid = "fun f nat x -> 1 ; # 1 2 3 4 5 6 7 8 9";
+    SLRParser* parser = slr_parser_init(g, &SLR_TABLE);
+    TokenView last;
+    assert(slr_parser_parse_pipelined(parser, invalid, strlen(invalid), NULL,
+                                      2, 1, &last) == PARSER_REJECT);
+    assert(last.ty == Invalid && last.start == 19);
+    destroy_slr_parser(parser);
+
+    no_threads = true;
+    parser = slr_parser_init(g, &SLR_TABLE);
+    assert(slr_parser_parse_pipelined(parser, invalid, strlen(invalid), NULL,
+                                      2, 1, &last) == PARSER_REJECT);
+    assert(last.ty == Invalid && last.start == 19);
+    destroy_slr_parser(parser);
+    no_threads = false;
+    destroy_grammar(g);
+}
+
+int main(int argc, char** argv) {
+    ring_test();
+    close_test();
+    // the remaining arguments are source files
+    parse_test(argv + 1, argc - 1);
+}
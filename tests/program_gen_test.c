@@ -0,0 +1,204 @@
+#include "../program_gen.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../parser.h"
+
+static Grammar* grammar;
+
+/* Parse `src`, the deepest the parser stack went is put in `peak` */
+ParserState parse_peak(const char* src, size_t len, size_t* peak) {
+    Lexer* lexer = lexer_new_n(src, len);
+    lexer_skip_comments(lexer, true);
+    SLRParser* parser = slr_parser_init(grammar, &SLR_TABLE);
+    slr_parser_trace(parser, false);
+    ParserState state;
+    *peak = 0;
+    do {
+        TokenView tok = lexer_next_view(lexer);
+        if (tok.ty == Invalid) {
+            state = PARSER_REJECT;
+            break;
+        }
+        state = slr_parser_step(parser, tok);
+        *peak = parser->stack_size > *peak ? parser->stack_size : *peak;
+    } while (state == PARSER_IDLE);
+    destroy_slr_parser(parser);
+    destroy_lexer(lexer);
+    return state;
+}
+
+ParserState parse(const char* src, size_t len) {
+    size_t peak;
+    return parse_peak(src, len, &peak);
+}
+
+/* Number of tokens of each type */
+void count_tokens(const char* src, size_t len, size_t counts[Invalid + 1]) {
+    memset(counts, 0, sizeof(size_t) * (Invalid + 1));
+    Lexer* lexer = lexer_new_n(src, len);
+    TokenTy ty;
+    do {
+        ty = lexer_next_view(lexer).ty;
+        counts[ty]++;
+    } while (ty != Eof);
+    destroy_lexer(lexer);
+}
+
+/* Deepest nesting of parentheses */
+unsigned paren_depth(const char* src) {
+    unsigned depth = 0, max = 0;
+    bool in_comment = false;
+    for (; *src != '\0'; src++) {
+        if (in_comment || *src == '[') {
+            in_comment = *src != ']';
+        } else if (*src == '(') {
+            depth++;
+            max = depth > max ? depth : max;
+        } else if (*src == ')') {
+            depth--;
+        }
+    }
+    return max;
+}
+
+// the same configuration gives the same program
+void seed_test() {
+    ProgramGenConf conf;
+    program_gen_conf_init(&conf, 7);
+    conf.size = 4096;
+    size_t len1, len2, len3;
+    char* p1 = program_gen(&conf, &len1);
+    char* p2 = program_gen(&conf, &len2);
+    conf.seed = 8;
+    char* p3 = program_gen(&conf, &len3);
+    assert(len1 == len2 && memcmp(p1, p2, len1) == 0);
+    assert(len1 != len3 || memcmp(p1, p3, len1) != 0);
+    assert(strlen(p1) == len1);
+    free(p1);
+    free(p2);
+    free(p3);
+}
+
+// every shape of valid program is accepted, every mutation is rejected
+void grammar_test() {
+    unsigned depths[] = {0, 3, 8};
+    unsigned densities[] = {0, 30};
+    unsigned cardinalities[] = {1, 5, 1000};
+    for (uint64_t seed = 0; seed < 8; seed++) {
+        for (size_t d = 0; d < 3; d++) {
+            for (size_t c = 0; c < 2; c++) {
+                for (size_t n = 0; n < 3; n++) {
+                    ProgramGenConf conf;
+                    program_gen_conf_init(&conf, seed);
+                    conf.size = 1024;
+                    conf.depth = depths[d];
+                    conf.comment_density = densities[c];
+                    conf.n_identifiers = cardinalities[n];
+                    size_t len;
+                    char* src = program_gen(&conf, &len);
+                    assert(parse(src, len) == PARSER_ACCEPT);
+                    free(src);
+                    conf.valid = false;
+                    for (conf.mutation = 0; conf.mutation < MUTATION_N_KINDS;
+                         conf.mutation++) {
+                        src = program_gen(&conf, &len);
+                        assert(parse(src, len) != PARSER_ACCEPT);
+                        free(src);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// size, number of definitions, identifiers and comments follow the config
+void shape_test() {
+    size_t counts[Invalid + 1];
+    ProgramGenConf conf;
+    program_gen_conf_init(&conf, 1);
+    conf.size = 8192;
+    size_t len;
+    char* src = program_gen(&conf, &len);
+    assert(len >= 8192 && len < 2 * 8192);
+    free(src);
+
+    conf.size = 0;
+    conf.n_funs = 7;
+    conf.comment_density = 0;
+    src = program_gen(&conf, &len);
+    count_tokens(src, len, counts);
+    assert(counts[FuncDecl] == 7);
+    assert(counts[Semicolon] == 7);
+    assert(counts[Comment] == 0);
+    free(src);
+
+    // a comment after every token
+    conf.comment_density = 100;
+    src = program_gen(&conf, &len);
+    count_tokens(src, len, counts);
+    size_t n_tokens = 0;
+    for (TokenTy ty = 0; ty < Eof; ty++) {
+        n_tokens += ty == Comment ? 0 : counts[ty];
+    }
+    assert(counts[Comment] == n_tokens);
+    free(src);
+
+    conf.n_identifiers = 3;
+    Interner* names = interner_new();
+    src = program_gen(&conf, &len);
+    Lexer* lexer = lexer_new_n(src, len);
+    lexer->interner = names;
+    TokenBuffer* tokens = lexer_tokenize_all(lexer);
+    assert(names->size <= 3);
+    destroy_token_buffer(tokens);
+    destroy_lexer(lexer);
+    destroy_interner(names);
+    free(src);
+
+    // only the final expression
+    conf.n_funs = 0;
+    src = program_gen(&conf, &len);
+    count_tokens(src, len, counts);
+    assert(counts[FuncDecl] == 0);
+    assert(parse(src, len) == PARSER_ACCEPT);
+    free(src);
+}
+
+// the deepest expression of every body reaches the requested depth
+void depth_test() {
+    ProgramGenConf conf;
+    program_gen_conf_init(&conf, 3);
+    conf.size = 0;
+    conf.n_funs = 2;
+    conf.depth = 200;
+    size_t len, peak;
+    char* src = program_gen(&conf, &len);
+    assert(paren_depth(src) <= 200);
+    // every level of the spine keeps `lit +` or `( id` on the stack
+    assert(parse_peak(src, len, &peak) == PARSER_ACCEPT);
+    assert(peak >= 2 * 200);
+    free(src);
+
+    // the generator itself does not recurse
+    conf.depth = 1000000;
+    conf.n_funs = 0;
+    conf.comment_density = 0;
+    src = program_gen(&conf, &len);
+    assert(len > 2 * 1000000);
+    assert(paren_depth(src) <= 1000000);
+    assert(parse_peak(src, len, &peak) == PARSER_ACCEPT);
+    assert(peak >= 2 * 1000000);
+    free(src);
+}
+
+int main() {
+    grammar = grammar_new();
+    seed_test();
+    grammar_test();
+    shape_test();
+    depth_test();
+    destroy_grammar(grammar);
+}
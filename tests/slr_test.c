@@ -1,5 +1,7 @@
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "../log.h"
 #include "../parser.h"
@@ -12,8 +14,8 @@ void smoke_test() {
     ParserState state;
     do {
         char buf[256];
-        Token* tok = lexer_next_token(lexer);
-        debug_token(tok, buf, 256);
+        TokenView tok = lexer_next_view(lexer);
+        debug_token_view(lexer, tok, buf, 256);
         log_info("Current Tok => %s", buf);
         state = slr_parser_step(parser, tok);
     } while (state == PARSER_IDLE);
@@ -27,23 +29,223 @@ void smoke_test() {
 void api_test() {
     Grammar* grammar = grammar_new();
     SLRParser* parser = slr_parser_init(grammar, &SLR_TABLE);
-    SLRop op = goto_table_get(SLR_TABLE.goto_table, 0, 'S');
+    SLRop op = goto_table_get(&SLR_TABLE, 0, 'S');
     assert(op.value == 1);
     assert(op.ty == SLR_GOTO);
-    op = shift_reduce_table_get(SHIFT_REDUCE_TABLE, 0, Identifier);
+    op = shift_reduce_table_get(&SLR_TABLE, 0, Identifier);
     assert(op.value == 0);
     assert(op.ty == SLR_EMPTY);
-    op = shift_reduce_table_get(SHIFT_REDUCE_TABLE, 8, Semicolon);
+    op = shift_reduce_table_get(&SLR_TABLE, 8, Semicolon);
     assert(op.value == 14);
     assert(op.ty == SLR_REDUCE);
-    op = shift_reduce_table_get(SHIFT_REDUCE_TABLE, 22, Colon);
+    op = shift_reduce_table_get(&SLR_TABLE, 22, Colon);
     assert(op.value == 29);
     assert(op.ty == SLR_SHIFT);
     destroy_slr_parser(parser);
     destroy_grammar(grammar);
 }
 
+/**
+ * Check a cell of table/SLR.csv against the compressed tables, `blank` is
+ * what an empty cell reads as
+ */
+void check_cell(const char* cell, SLRop op, SLRop blank) {
+    if (cell[0] == 's') {
+        assert(op.ty == SLR_SHIFT && op.value == (unsigned)atoi(cell + 1));
+    } else if (cell[0] == 'r') {
+        assert(op.ty == SLR_REDUCE && op.value == (unsigned)atoi(cell + 1));
+    } else if (cell[0] != '\0') {
+        assert(op.ty == SLR_GOTO && op.value == (unsigned)atoi(cell));
+    } else {
+        assert(op.ty == blank.ty && op.value == blank.value);
+    }
+}
+
+// every cell of the uncompressed table is found in the compressed one
+void table_test() {
+    const TokenTy terminals[SLR_N_TERMINALS] = {
+        Semicolon,    FuncDecl, Identifier, Arrow,      NatDecl, BoolDecl,
+        QuestionMark, Colon,    LeftParen,  RightParen, Literal, Plus,
+        Ampersand,    Less,     Equal,      Eof};
+    const NonTerminal non_terminals[SLR_N_NON_TERMINALS] = {
+        'S', 'F', 'A', 'T', 'C', 'E', 'I', 'B', 'R'};
+    FILE* fp = fopen("table/SLR.csv", "r");
+    assert(fp != NULL);
+    char line[512];
+    // state, the terminals, S' and the non-terminals
+    assert(fgets(line, sizeof(line), fp) != NULL);
+    unsigned state = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char* cells[2 + SLR_N_TERMINALS + SLR_N_NON_TERMINALS];
+        size_t n_cells = 0;
+        for (char* p = line; n_cells < sizeof(cells) / sizeof(cells[0]);) {
+            cells[n_cells++] = p;
+            p += strcspn(p, ",\r\n");
+            if (*p != ',') {
+                *p = '\0';
+                break;
+            }
+            *p++ = '\0';
+        }
+        assert(n_cells == sizeof(cells) / sizeof(cells[0]));
+        assert((unsigned)atoi(cells[0]) == state);
+        // an error, or the default reduction of the state
+        int16_t reduction = SLR_DEFAULT_REDUCTION[state];
+        SLRop error = {SLR_EMPTY, 0};
+        SLRop blank = reduction < 0
+                          ? (SLRop){SLR_REDUCE, (unsigned)(-reduction - 1)}
+                          : error;
+        assert(reduction <= 0 && (blank.ty == SLR_EMPTY || blank.value != 0));
+        for (size_t t = 0; t < SLR_N_TERMINALS; t++) {
+            check_cell(cells[1 + t],
+                       shift_reduce_table_get(&SLR_TABLE, state, terminals[t]),
+                       blank);
+        }
+        for (size_t n = 0; n < SLR_N_NON_TERMINALS; n++) {
+            check_cell(cells[2 + SLR_N_TERMINALS + n],
+                       goto_table_get(&SLR_TABLE, state, non_terminals[n]),
+                       error);
+        }
+        state++;
+    }
+    assert(state == 38);
+    fclose(fp);
+}
+
+/* Parse `src` with the trace streamed to a temporary file, or displayed */
+char* parse_trace(const char* src, bool stream, unsigned step_width,
+                  unsigned stack_width) {
+    Lexer* lexer = lexer_new(src);
+    Grammar* grammar = grammar_new();
+    SLRParser* parser = slr_parser_init(grammar, &SLR_TABLE);
+    FILE* fp = tmpfile();
+    if (stream) {
+        slr_parser_stream_trace(parser, fp, step_width, stack_width);
+    }
+    while (slr_parser_step(parser, lexer_next_view(lexer)) == PARSER_IDLE) {
+    }
+    slr_parser_display_trace(parser, stream ? NULL : fp);
+    destroy_slr_parser(parser);
+    destroy_grammar(grammar);
+    destroy_lexer(lexer);
+
+    long len = ftell(fp);
+    char* out = malloc(len + 1);
+    rewind(fp);
+    assert(fread(out, 1, len, fp) == (size_t)len);
+    out[len] = '\0';
+    fclose(fp);
+    return out;
+}
+
+/* Copy of `s` without its spaces */
+char* strip_spaces(const char* s) {
+    char* out = malloc(strlen(s) + 1);
+    char* p = out;
+    for (; *s != '\0'; s++) {
+        if (*s != ' ') {
+            *p++ = *s;
+        }
+    }
+    *p = '\0';
+    return out;
+}
+
+// the streamed trace has the rows of the displayed one
+void stream_test() {
+    const char* srcs[] = {"fun f1 nat a -> 1; 2", "fun f ( 1 ? 2", "1 + 2 +"};
+    for (size_t i = 0; i < sizeof(srcs) / sizeof(srcs[0]); i++) {
+        char* displayed = parse_trace(srcs[i], false, 0, 0);
+        // the widths of the displayed columns, from the first row
+        unsigned step_width = strchr(displayed, ':') - displayed - 5;
+        unsigned stack_width = strchr(displayed, '\t') - displayed;
+        stack_width -= step_width + 7;
+        char* fixed = parse_trace(srcs[i], true, step_width, stack_width);
+        assert(strcmp(fixed, displayed) == 0);
+
+        char* adaptive = parse_trace(srcs[i], true, 0, 0);
+        char* a = strip_spaces(adaptive);
+        char* b = strip_spaces(displayed);
+        assert(strcmp(a, b) == 0);
+        free(a);
+        free(b);
+        free(adaptive);
+        free(fixed);
+        free(displayed);
+    }
+}
+
+typedef struct DeepParse {
+    const char* src;
+    size_t len;
+    ParserState state;
+} DeepParse;
+
+void* deep_parse(void* arg) {
+    DeepParse* job = arg;
+    Grammar* grammar = grammar_new();
+    Lexer* lexer = lexer_new_n(job->src, job->len);
+    SLRParser* parser = slr_parser_init(grammar, &SLR_TABLE);
+    slr_parser_trace(parser, false);
+    do {
+        job->state = slr_parser_step(parser, lexer_next_view(lexer));
+    } while (job->state == PARSER_IDLE);
+    destroy_parse_tree(slr_parser_parse_tree(parser));
+    destroy_slr_parser(parser);
+    destroy_lexer(lexer);
+    destroy_grammar(grammar);
+    return NULL;
+}
+
+/* Parse on a thread with a small stack, which a frame per level overflows */
+ParserState parse_with_small_stack(const char* src, size_t len) {
+    DeepParse job = {.src = src, .len = len, .state = PARSER_IDLE};
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 256u << 10);
+    pthread_t thread;
+    assert(pthread_create(&thread, &attr, deep_parse, &job) == 0);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+    return job.state;
+}
+
+/* Repeat `s` n times, then append `tail` */
+char* repeat(const char* s, size_t n, const char* tail, size_t* len) {
+    size_t s_len = strlen(s), tail_len = strlen(tail);
+    char* out = malloc(s_len * n + tail_len + 1);
+    for (size_t i = 0; i < n; i++) {
+        memcpy(out + i * s_len, s, s_len);
+    }
+    memcpy(out + s_len * n, tail, tail_len + 1);
+    *len = s_len * n + tail_len;
+    return out;
+}
+
+// a million levels of nesting, reduced in a row at the end of the input
+void deep_test() {
+    size_t depth = 1000000, len;
+    // E -> lit + E
+    char* src = repeat("1 + ", depth, "1", &len);
+    assert(parse_with_small_stack(src, len) == PARSER_ACCEPT);
+    free(src);
+
+    // C -> B ? E : C
+    src = repeat("1 < 2 ? 3 : ", depth, "4", &len);
+    assert(parse_with_small_stack(src, len) == PARSER_ACCEPT);
+    free(src);
+
+    // rejected only once the whole spine is reduced, the deep partial tree
+    // is then freed
+    src = repeat("1 + ", depth, "1 )", &len);
+    assert(parse_with_small_stack(src, len) == PARSER_REJECT);
+    free(src);
+}
+
 int main() {
     smoke_test();
     api_test();
+    table_test();
+    stream_test();
+    deep_test();
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "../source.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// a regular file is mapped
+void file_test() {
+    char path[] = "/tmp/mini-compiler-source-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    const char *text = "fun f (x : nat) -> nat; [ comment ]";
+    assert(write(fd, text, strlen(text)) == (ssize_t)strlen(text));
+    close(fd);
+
+    Source *src = source_open(path);
+    assert(src != NULL);
+    assert(src->mapped);
+    assert(src->len == strlen(text));
+    assert(memcmp(src->data, text, src->len) == 0);
+    destroy_source(src);
+
+    // empty files can't be mapped
+    fd = open(path, O_WRONLY | O_TRUNC);
+    close(fd);
+    src = source_open(path);
+    assert(src != NULL);
+    assert(src->len == 0);
+    destroy_source(src);
+
+    unlink(path);
+    assert(source_open(path) == NULL);
+}
+
+// a pipe is read until its end, growing the buffer
+void pipe_test() {
+    int fds[2];
+    assert(pipe(fds) == 0);
+    size_t len = 40000; /* fits in the pipe buffer */
+    char *text = malloc(len);
+    for (size_t i = 0; i < len; i++) {
+        text[i] = "fun x;\n"[i % 7];
+    }
+    assert(write(fds[1], text, len) == (ssize_t)len);
+    close(fds[1]);
+
+    Source *src = source_from_fd(fds[0]);
+    assert(src != NULL);
+    assert(!src->mapped);
+    assert(src->len == len);
+    assert(memcmp(src->data, text, len) == 0);
+    destroy_source(src);
+    close(fds[0]);
+    free(text);
+}
+
+int main() {
+    file_test();
+    pipe_test();
+    return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 SymbolTy gen_ty(unsigned i) {
     switch (i % 3) {
@@ -17,26 +18,32 @@ SymbolTy gen_ty(unsigned i) {
 }
 
 void fuzzy_test() {
-    SymbolTable *t = symbol_table_new();
+    Interner *names = interner_new();
+    SymbolTable *t = symbol_table_new(names);
     char buf[64];
     for (unsigned i = 0; i < 1000; i++) {
         snprintf(buf, sizeof(buf), "%u", i);
-        symbol_table_insert(t, buf, gen_ty(i));
+        symbol_table_insert(t, interner_intern(names, buf, strlen(buf)),
+                            gen_ty(i));
     }
     for (unsigned i = 0; i < 1000; i++) {
         snprintf(buf, sizeof(buf), "%u", i);
-        assert(symbol_table_find(t, buf) == gen_ty(i));
+        assert(symbol_table_find(t, interner_find(names, buf, strlen(buf))) ==
+               gen_ty(i));
     }
     symbol_table_walk(t);
     symbol_table_destroy(t);
+    destroy_interner(names);
 }
 
 void duplicate_symbol_test() {
-    SymbolTable *t = symbol_table_new();
-    symbol_table_insert(t, "1", FuncTy);
-    symbol_table_insert(t, "1", BoolTy);
-    assert(symbol_table_find(t, "1") == FuncTy);
+    Interner *names = interner_new();
+    SymbolTable *t = symbol_table_new(names);
+    symbol_table_insert(t, interner_intern(names, "1", 1), FuncTy);
+    symbol_table_insert(t, interner_intern(names, "1", 1), BoolTy);
+    assert(symbol_table_find(t, interner_intern(names, "1", 1)) == FuncTy);
     symbol_table_destroy(t);
+    destroy_interner(names);
 }
 
 int main() {